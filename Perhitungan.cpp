@@ -1,11 +1,15 @@
 // mpreal_sqrt_newton.cpp
-// Precision square-root with Newton (Heron) and reciprocal-sqrt iterations
+// Precision square-root with Newton (Heron), reciprocal-sqrt and Karp–Markstein iterations
 // Uses AdvAnPix MPFR C++ wrapper (mpreal): https://github.com/advanpix/mpreal
 // - Parses command-line options
 // - Allows manual or automatic initial guess
-// - Stores per-iteration values, prints and can save CSV
-// - Times algorithms in nanoseconds using an independent timer
-// - Compares to mpfr builtin sqrt (computed at higher precision) and to std::sqrt (double)
+// - Optional precision-doubling schedule (each Newton step runs at about twice the previous precision)
+// - Optional early termination once the iterate stops changing (--until-converged / --tol)
+// - Streams per-iteration values to the table and/or CSV as they are produced (no stored history)
+// - Times algorithms in nanoseconds using an independent timer; --bench repeats and summarises
+// - Compares to mpfr builtin sqrt (computed at higher precision) and to std::sqrt (double), or to
+//   mpfr_rootn_ui and std::cbrt / std::pow for --root N
+// - sqrt_batch: structure-of-arrays library entry point (build with -DMPREAL_SQRT_NO_MAIN to embed)
 // - Optional BOOST comparison if compiled with -DUSE_BOOST and Boost.Multiprecision available
 
 #include <iostream>
@@ -14,267 +18,3784 @@
 #include <vector>
 #include <chrono>
 #include <cmath>
+#include <cfloat>
+#include <climits>
 #include <fstream>
 #include <sstream>
 #include <functional>
 #include <cstdlib>
+#include <cctype>
+#include <cstdio>
 #include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <array>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#define MPREAL_SQRT_HAVE_MMAP 1 // --spill-dir; also getrusage for --stats
+#endif
 
 #include "mpreal.h" // from the AdvAnPix/mpreal project
 
-// If you want Boost multiprecision comparison, compile with -DUSE_BOOST and have Boost installed
-#ifdef USE_BOOST
-#include <boost/multiprecision/cpp_dec_float.hpp>
-using boost::multiprecision::cpp_dec_float_50; // example type if available
-#endif
+// If you want Boost multiprecision comparison, compile with -DUSE_BOOST and have Boost installed
+#ifdef USE_BOOST
+#include <boost/multiprecision/cpp_dec_float.hpp>
+using boost::multiprecision::cpp_dec_float_50; // example type if available
+#endif
+
+using mpfr::mpreal;
+
+// Convert decimal digits to bits (roughly)
+inline unsigned long digits_to_bits(unsigned long dec_digits) {
+    constexpr long double LOG2_10 = 3.321928094887362347870319429489L; // log2(10)
+    return static_cast<unsigned long>(std::ceil(dec_digits * LOG2_10));
+}
+
+// Independent monotonic timer: runs a callable and returns pair(result, elapsed_ns)
+// (steady_clock: high_resolution_clock may be the wall clock and jump)
+template<typename F>
+auto time_in_ns(F&& f) -> std::pair<decltype(f()), long long> {
+    using namespace std::chrono;
+    auto t0 = steady_clock::now();
+    decltype(f()) result = f();
+    auto t1 = steady_clock::now();
+    long long ns = duration_cast<nanoseconds>(t1 - t0).count();
+    return { result, ns };
+}
+
+// --arena: GMP/MPFR memory hooks backed by a thread-local bump allocator.
+// While an ArenaScope is open on a thread, every fresh GMP allocation on that thread is carved out of
+// the thread's chunks and frees are no-ops; closing the scope rewinds the arena, so one batch input
+// costs no malloc/free at all once the chunks have grown to fit it (and threads never contend in
+// malloc). Outside a scope, and for blocks that came from malloc, the hooks fall back to the heap.
+// Rules that keep this safe: values that outlive a scope must be allocated (and sized) before it
+// opens, and a GMP block is freed on the thread that allocated it.
+struct ArenaStats {
+    unsigned long long arena_allocs = 0; // served from an arena
+    unsigned long long heap_allocs = 0;  // served by malloc/realloc while the hooks were installed
+    size_t peak_bytes = 0;               // largest arena footprint of a single scope
+};
+
+class GmpArena {
+public:
+    ~GmpArena() {
+        fold_into_total(); // thread exit: keep this thread's numbers for the summary
+        for (auto& c : chunks_) std::free(c.base);
+    }
+
+    bool active() const { return depth_ > 0; }
+    const ArenaStats& stats() const { return stats_; }
+
+    void* alloc(size_t n) {
+        n = (n + ALIGN - 1) & ~(ALIGN - 1);
+        if (chunks_.empty() || off_ + n > chunks_[cur_].size) next_chunk(n);
+        last_ = chunks_[cur_].base + off_;
+        off_ += n;
+        used_ += n;
+        ++stats_.arena_allocs;
+        return last_;
+    }
+
+    // the most recent block can grow in place; anything else moves
+    void* grow(void* p, size_t old_n, size_t n) {
+        size_t rounded = (n + ALIGN - 1) & ~(ALIGN - 1);
+        if (p == last_ && static_cast<char*>(p) + rounded <= chunks_[cur_].base + chunks_[cur_].size) {
+            size_t old_rounded = (old_n + ALIGN - 1) & ~(ALIGN - 1);
+            off_ = off_ - old_rounded + rounded;
+            used_ = used_ - old_rounded + rounded;
+            return p;
+        }
+        void* q = alloc(n);
+        std::memcpy(q, p, std::min(old_n, n));
+        return q;
+    }
+
+    bool owns(const void* p) const {
+        const char* c = static_cast<const char*>(p);
+        for (const auto& ch : chunks_) {
+            if (c >= ch.base && c < ch.base + ch.size) return true;
+        }
+        return false;
+    }
+
+    void open() { ++depth_; }
+
+    void close() {
+        if (--depth_ > 0) return;
+        mpfr_mp_memory_cleanup(); // MPFR's mpz pool and constant caches may hold arena blocks
+        stats_.peak_bytes = std::max(stats_.peak_bytes, used_);
+        size_t total = 0;
+        for (auto& c : chunks_) total += c.size;
+        if (chunks_.size() > 1) { // settle on one chunk that fits a whole scope
+            for (auto& c : chunks_) std::free(c.base);
+            chunks_.clear();
+            chunks_.push_back({ static_cast<char*>(checked_malloc(total)), total });
+        }
+        cur_ = off_ = used_ = 0;
+        last_ = nullptr;
+    }
+
+    void count_heap_alloc() { ++stats_.heap_allocs; }
+
+    static void* checked_malloc(size_t n) {
+        void* p = std::malloc(n);
+        if (!p && n) {
+            std::cerr << "out of memory allocating " << n << " bytes\n";
+            std::abort();
+        }
+        return p;
+    }
+
+    // Stats of threads that have exited plus this thread's
+    static ArenaStats total(const GmpArena& current) {
+        std::lock_guard<std::mutex> lk(total_mutex());
+        ArenaStats t = total_stats();
+        t.arena_allocs += current.stats_.arena_allocs;
+        t.heap_allocs += current.stats_.heap_allocs;
+        t.peak_bytes = std::max({ t.peak_bytes, current.stats_.peak_bytes, current.used_ }); // open scope counts too
+        return t;
+    }
+
+private:
+    struct Chunk {
+        char* base;
+        size_t size;
+    };
+    static constexpr size_t ALIGN = 16;
+    static constexpr size_t FIRST_CHUNK = size_t(1) << 20;
+
+    void next_chunk(size_t n) {
+        if (!chunks_.empty() && cur_ + 1 < chunks_.size() && chunks_[cur_ + 1].size >= n) {
+            ++cur_;
+        }
+        else {
+            size_t size = std::max(n, chunks_.empty() ? FIRST_CHUNK : 2 * chunks_.back().size);
+            chunks_.push_back({ static_cast<char*>(checked_malloc(size)), size });
+            cur_ = chunks_.size() - 1;
+        }
+        off_ = 0;
+    }
+
+    void fold_into_total() {
+        std::lock_guard<std::mutex> lk(total_mutex());
+        ArenaStats& t = total_stats();
+        t.arena_allocs += stats_.arena_allocs;
+        t.heap_allocs += stats_.heap_allocs;
+        t.peak_bytes = std::max(t.peak_bytes, stats_.peak_bytes);
+        stats_ = ArenaStats();
+    }
+
+    static std::mutex& total_mutex() { static std::mutex m; return m; }
+    static ArenaStats& total_stats() { static ArenaStats t; return t; }
+
+    std::vector<Chunk> chunks_;
+    size_t cur_ = 0, off_ = 0, used_ = 0;
+    char* last_ = nullptr;
+    int depth_ = 0;
+    ArenaStats stats_;
+};
+
+inline GmpArena& thread_arena() {
+    thread_local GmpArena arena;
+    return arena;
+}
+
+void* arena_gmp_alloc(size_t n) {
+    GmpArena& ar = thread_arena();
+    if (ar.active()) return ar.alloc(n);
+    ar.count_heap_alloc();
+    return GmpArena::checked_malloc(n);
+}
+
+void* arena_gmp_realloc(void* p, size_t old_n, size_t n) {
+    GmpArena& ar = thread_arena();
+    if (ar.owns(p)) {
+        if (ar.active()) return ar.grow(p, old_n, n);
+        void* q = GmpArena::checked_malloc(n); // block outlived its scope: move it to the heap
+        std::memcpy(q, p, std::min(old_n, n));
+        ar.count_heap_alloc();
+        return q;
+    }
+    // heap blocks stay on the heap, so long-lived values that grow inside a scope remain valid after it
+    ar.count_heap_alloc();
+    void* q = std::realloc(p, n);
+    if (!q && n) {
+        std::cerr << "out of memory reallocating " << n << " bytes\n";
+        std::abort();
+    }
+    return q;
+}
+
+void arena_gmp_free(void* p, size_t) {
+    if (!thread_arena().owns(p)) std::free(p); // arena blocks are reclaimed when their scope closes
+}
+
+void install_arena_hooks() {
+    mpfr_mp_memory_cleanup(); // required before changing GMP's memory functions
+    mp_set_memory_functions(arena_gmp_alloc, arena_gmp_realloc, arena_gmp_free);
+}
+
+// Opens the calling thread's arena for its lifetime (no-op when enabled is false)
+class ArenaScope {
+public:
+    explicit ArenaScope(bool enabled) : enabled_(enabled) {
+        if (enabled_) thread_arena().open();
+    }
+    ~ArenaScope() {
+        if (enabled_) thread_arena().close();
+    }
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    bool enabled_;
+};
+
+std::string format_arena_stats(const ArenaStats& st) {
+    std::ostringstream os;
+    os << "Arena: " << st.arena_allocs << " arena allocations, " << st.heap_allocs << " heap allocations, peak "
+        << st.peak_bytes << " bytes per scope";
+    return os.str();
+}
+
+// --spill-dir: GMP/MPFR blocks of at least SPILL_MIN_BYTES are mapped from unlinked temporary files
+// in that directory (MAP_SHARED), so the kernel can write their pages back to disk and drop them
+// under memory pressure instead of failing; smaller blocks stay on the heap. Not combined with --arena.
+constexpr size_t SPILL_MIN_BYTES = size_t(16) << 20;
+
+class SpillStore {
+public:
+    static SpillStore& instance() {
+        static SpillStore s;
+        return s;
+    }
+
+    void set_dir(const std::string& dir) { dir_ = dir; }
+
+    // n bytes backed by a fresh file, or nullptr when it cannot be mapped
+    void* map(size_t n) {
+#ifdef MPREAL_SQRT_HAVE_MMAP
+        std::string path = dir_ + "/mpreal_sqrt_spill_XXXXXX";
+        int fd = mkstemp(&path[0]);
+        if (fd < 0) return nullptr;
+        unlink(path.c_str()); // the mapping keeps the file alive; nothing is left behind on exit
+        void* p = ftruncate(fd, static_cast<off_t>(n)) == 0 ? mmap(nullptr, n, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        close(fd);
+        if (p == MAP_FAILED) return nullptr;
+        std::lock_guard<std::mutex> lk(m_);
+        blocks_[p] = n;
+        bytes_ += n;
+        peak_ = std::max(peak_, bytes_);
+        ++files_;
+        return p;
+#else
+        (void)n;
+        return nullptr;
+#endif
+    }
+
+    bool owns(void* p) {
+        std::lock_guard<std::mutex> lk(m_);
+        return blocks_.count(p) != 0;
+    }
+
+    // Unmaps p; false when p is not a spilled block
+    bool unmap(void* p) {
+#ifdef MPREAL_SQRT_HAVE_MMAP
+        size_t n;
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            auto it = blocks_.find(p);
+            if (it == blocks_.end()) return false;
+            n = it->second;
+            bytes_ -= n;
+            blocks_.erase(it);
+        }
+        munmap(p, n);
+        return true;
+#else
+        (void)p;
+        return false;
+#endif
+    }
+
+    std::string summary() {
+        std::lock_guard<std::mutex> lk(m_);
+        std::ostringstream os;
+        os << "Spill: " << files_ << " blocks mapped from " << dir_ << ", peak " << (peak_ >> 20) << " MiB";
+        return os.str();
+    }
+
+private:
+    std::string dir_;
+    std::mutex m_;
+    std::unordered_map<void*, size_t> blocks_;
+    size_t bytes_ = 0, peak_ = 0, files_ = 0;
+};
+
+void* spill_gmp_alloc(size_t n) {
+    if (n >= SPILL_MIN_BYTES) {
+        if (void* p = SpillStore::instance().map(n)) return p;
+    }
+    return GmpArena::checked_malloc(n);
+}
+
+void spill_gmp_free(void* p, size_t) {
+    if (!SpillStore::instance().unmap(p)) std::free(p);
+}
+
+void* spill_gmp_realloc(void* p, size_t old_n, size_t n) {
+    if (n < SPILL_MIN_BYTES && !SpillStore::instance().owns(p)) {
+        void* q = std::realloc(p, n);
+        if (!q && n) {
+            std::cerr << "out of memory reallocating " << n << " bytes\n";
+            std::abort();
+        }
+        return q;
+    }
+    void* q = spill_gmp_alloc(n);
+    std::memcpy(q, p, std::min(old_n, n));
+    spill_gmp_free(p, old_n);
+    return q;
+}
+
+// Routes GMP's memory through SpillStore; false (with a message) where mmap is unavailable
+bool install_spill_hooks(const std::string& dir) {
+#ifdef MPREAL_SQRT_HAVE_MMAP
+    SpillStore::instance().set_dir(dir);
+    mpfr_mp_memory_cleanup();
+    mp_set_memory_functions(spill_gmp_alloc, spill_gmp_realloc, spill_gmp_free);
+    return true;
+#else
+    (void)dir;
+    std::cerr << "--spill-dir needs mmap, which this platform does not provide\n";
+    return false;
+#endif
+}
+
+// --stats: a counting layer over whichever GMP memory functions are installed (default, --arena or
+// --spill-dir). Counters are process-wide; live bytes follow GMP's view, so arena blocks count as
+// freed when GMP frees them even though the arena reclaims them later.
+struct AllocCounters {
+    std::atomic<unsigned long long> allocs{ 0 }, reallocs{ 0 }, frees{ 0 }, bytes{ 0 };
+    std::atomic<long long> live{ 0 }, peak{ 0 };
+};
+
+inline AllocCounters& alloc_counters() {
+    static AllocCounters c;
+    return c;
+}
+
+struct GmpMemoryFunctions {
+    void* (*alloc)(size_t) = nullptr;
+    void* (*realloc)(void*, size_t, size_t) = nullptr;
+    void (*free)(void*, size_t) = nullptr;
+};
+
+inline GmpMemoryFunctions& counted_functions() { // the functions the counting layer forwards to
+    static GmpMemoryFunctions f;
+    return f;
+}
+
+inline void count_live(long long delta) {
+    AllocCounters& c = alloc_counters();
+    long long now = c.live += delta;
+    long long peak = c.peak.load();
+    while (now > peak && !c.peak.compare_exchange_weak(peak, now)) {}
+}
+
+void* counting_gmp_alloc(size_t n) {
+    ++alloc_counters().allocs;
+    alloc_counters().bytes += n;
+    count_live(static_cast<long long>(n));
+    return counted_functions().alloc(n);
+}
+
+void* counting_gmp_realloc(void* p, size_t old_n, size_t n) {
+    ++alloc_counters().reallocs;
+    if (n > old_n) alloc_counters().bytes += n - old_n;
+    count_live(static_cast<long long>(n) - static_cast<long long>(old_n));
+    return counted_functions().realloc(p, old_n, n);
+}
+
+void counting_gmp_free(void* p, size_t n) {
+    ++alloc_counters().frees;
+    count_live(-static_cast<long long>(n));
+    counted_functions().free(p, n);
+}
+
+void install_counting_hooks() {
+    GmpMemoryFunctions& f = counted_functions();
+    mp_get_memory_functions(&f.alloc, &f.realloc, &f.free);
+    mpfr_mp_memory_cleanup();
+    mp_set_memory_functions(counting_gmp_alloc, counting_gmp_realloc, counting_gmp_free);
+}
+
+// Peak resident set size of the process in bytes, -1 where getrusage is unavailable
+long long peak_rss_bytes() {
+#ifdef MPREAL_SQRT_HAVE_MMAP
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return -1;
+#ifdef __APPLE__
+    return static_cast<long long>(ru.ru_maxrss); // bytes on macOS
+#else
+    return static_cast<long long>(ru.ru_maxrss) * 1024; // KiB on Linux and the BSDs
+#endif
+#else
+    return -1;
+#endif
+}
+
+// --trace: Chrome trace events (chrome://tracing, Perfetto) for the phases of a single run, each kernel
+// step, decimal conversion and the ParallelMul blocks. A TRACE_SCOPE costs one branch while tracing
+// is off; building with -DMPREAL_SQRT_NO_TRACE removes the scopes altogether.
+class Tracer {
+public:
+    static Tracer& instance() {
+        static Tracer t;
+        return t;
+    }
+
+    bool enabled() const { return enabled_; }
+
+    void enable() {
+        origin_ = std::chrono::steady_clock::now();
+        enabled_ = true;
+    }
+
+    static int thread_id() { // small stable ids, 1 = the first thread that traced
+        static std::atomic<int> next{ 1 };
+        thread_local int id = next++;
+        return id;
+    }
+
+    // One complete ("X") event; prec 0 and bytes < 0 leave the arg out. bytes is the GMP byte count
+    // allocated meanwhile, process-wide, so overlapping threads share it.
+    void complete(const char* name, const char* cat, std::chrono::steady_clock::time_point t0, long long ns, mpfr_prec_t prec, long long bytes) {
+        Event e{ name, cat, std::chrono::duration_cast<std::chrono::nanoseconds>(t0 - origin_).count(), ns, prec, bytes, thread_id() };
+        std::lock_guard<std::mutex> lk(m_);
+        events_.push_back(e);
+    }
+
+    bool write(const std::string& file) {
+        std::ofstream f(file);
+        if (!f) return false;
+        std::lock_guard<std::mutex> lk(m_);
+        f << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+        for (size_t i = 0; i < events_.size(); ++i) {
+            const Event& e = events_[i];
+            f << "{\"name\": \"" << e.name << "\", \"cat\": \"" << e.cat << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << e.tid
+                << ", \"ts\": " << e.ts_ns / 1000 << "." << std::setw(3) << std::setfill('0') << e.ts_ns % 1000
+                << ", \"dur\": " << e.ns / 1000 << "." << std::setw(3) << e.ns % 1000 << std::setfill(' ') << ", \"args\": {";
+            const char* sep = "";
+            if (e.prec) { f << "\"prec_bits\": " << e.prec; sep = ", "; }
+            if (e.bytes >= 0) f << sep << "\"gmp_bytes\": " << e.bytes;
+            f << "}}" << (i + 1 < events_.size() ? "," : "") << "\n";
+        }
+        f << "]}\n";
+        return static_cast<bool>(f);
+    }
+
+private:
+    struct Event {
+        const char* name;
+        const char* cat;
+        long long ts_ns, ns;
+        mpfr_prec_t prec;
+        long long bytes;
+        int tid;
+    };
+    bool enabled_ = false;
+    std::chrono::steady_clock::time_point origin_;
+    std::mutex m_;
+    std::vector<Event> events_;
+};
+
+class TraceScope {
+public:
+    TraceScope(const char* name, const char* cat, mpfr_prec_t prec = 0) {
+        if (!Tracer::instance().enabled()) return;
+        name_ = name;
+        cat_ = cat;
+        prec_ = prec;
+        bytes_ = alloc_counters().bytes;
+        t0_ = std::chrono::steady_clock::now();
+    }
+    ~TraceScope() {
+        if (!name_) return;
+        long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0_).count();
+        Tracer::instance().complete(name_, cat_, t0_, ns, prec_, static_cast<long long>(alloc_counters().bytes - bytes_));
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name_ = nullptr;
+    const char* cat_ = nullptr;
+    mpfr_prec_t prec_ = 0;
+    unsigned long long bytes_ = 0;
+    std::chrono::steady_clock::time_point t0_;
+};
+
+#ifdef MPREAL_SQRT_NO_TRACE
+#define TRACE_SCOPE(...) ((void)0)
+#else
+#define TRACE_SCOPE(...) TraceScope trace_scope_(__VA_ARGS__)
+#endif
+
+// Per-phase breakdown for --stats: begin(name) closes the open phase and starts the next one.
+// add() records a phase that ran on a helper thread (wall time only: its allocations are already
+// counted in the phases it overlapped). Phases also go to the --trace file.
+class RunStats {
+public:
+    explicit RunStats(bool enabled) : enabled_(enabled) {}
+
+    bool enabled() const { return enabled_; }
+
+    void begin(const char* name) {
+        if (!enabled_) return;
+        end();
+        open_ = true;
+        cur_ = Phase();
+        cur_.name = name;
+        cur_.allocs = alloc_counters().allocs + alloc_counters().reallocs;
+        cur_.bytes = alloc_counters().bytes;
+        t0_ = std::chrono::steady_clock::now();
+    }
+
+    void end() {
+        if (!enabled_ || !open_) return;
+        open_ = false;
+        cur_.ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0_).count();
+        cur_.allocs = alloc_counters().allocs + alloc_counters().reallocs - cur_.allocs;
+        cur_.bytes = alloc_counters().bytes - cur_.bytes;
+        if (Tracer::instance().enabled()) Tracer::instance().complete(cur_.name, "phase", t0_, cur_.ns, 0, static_cast<long long>(cur_.bytes));
+        phases_.push_back(cur_);
+    }
+
+    void add(const char* name, std::chrono::steady_clock::time_point t0, long long ns) {
+        if (!enabled_) return;
+        if (Tracer::instance().enabled()) Tracer::instance().complete(name, "phase", t0, ns, 0, -1);
+        std::lock_guard<std::mutex> lk(m_);
+        Phase ph;
+        ph.name = name;
+        ph.ns = ns;
+        ph.helper = true;
+        phases_.push_back(ph);
+    }
+
+    // history_bytes: iterate values kept by the run (the kernels stream them, so 0)
+    void write_json(std::ostream& os, size_t history_bytes) {
+        end();
+        const AllocCounters& c = alloc_counters();
+        os << "{\n  \"peak_rss_bytes\": " << peak_rss_bytes() << ",\n  \"gmp\": {\"allocations\": " << c.allocs
+            << ", \"reallocations\": " << c.reallocs << ", \"frees\": " << c.frees << ", \"bytes_allocated\": " << c.bytes
+            << ", \"peak_live_bytes\": " << c.peak << "},\n  \"iteration_history_bytes\": " << history_bytes
+            << ",\n  \"phases\": [\n";
+        for (size_t i = 0; i < phases_.size(); ++i) {
+            const Phase& ph = phases_[i];
+            os << "    {\"name\": \"" << ph.name << "\", \"ns\": " << ph.ns;
+            if (ph.helper) os << ", \"helper_thread\": true";
+            else os << ", \"allocations\": " << ph.allocs << ", \"bytes_allocated\": " << ph.bytes;
+            os << "}" << (i + 1 < phases_.size() ? "," : "") << "\n";
+        }
+        os << "  ]\n}\n";
+    }
+
+private:
+    struct Phase {
+        const char* name = ""; // a literal: the tracer keeps the pointer
+        long long ns = 0;
+        unsigned long long allocs = 0, bytes = 0;
+        bool helper = false;
+    };
+    bool enabled_;
+    bool open_ = false;
+    Phase cur_;
+    std::chrono::steady_clock::time_point t0_;
+    std::mutex m_;
+    std::vector<Phase> phases_;
+};
+
+// Precision (bits) of the seed in the doubling schedule: what a double carries
+constexpr mpfr_prec_t SEED_PREC_BITS = 53;
+// Guard bits added on each halving so rounding in one step does not eat the next step's gain
+constexpr mpfr_prec_t SCHEDULE_GUARD_BITS = 16;
+
+// Working precision for every iterate: entry 0 is the precision of the seed, entry i (1..iterations)
+// the precision iteration i runs at.
+//  - "fixed":    every entry is target_bits (classic behaviour)
+//  - "doubling": ramp target, target/2+g, target/4+g, ... down to seed_bits, aligned so the last
+//                iteration runs at target_bits; any extra leading iterations run at the seed precision.
+//                An entry within g of seed_bits is dropped: one step from the seed already gives
+//                ~2*seed_bits, so the ramp never buys a few bits at the cost of a full step.
+// seed_bits is how many bits of the seed are correct: SEED_PREC_BITS for the double-based guesses,
+// more for a --resume-from seed, which then needs only about log2(target/seed) doublings.
+std::vector<mpfr_prec_t> build_precision_schedule(const std::string& schedule, mpfr_prec_t target_bits, int iterations,
+                                                  mpfr_prec_t seed_bits = SEED_PREC_BITS) {
+    int n = std::max(0, iterations);
+    if (schedule != "doubling" || target_bits <= seed_bits) {
+        return std::vector<mpfr_prec_t>(n + 1, target_bits);
+    }
+    std::vector<mpfr_prec_t> ramp{ target_bits };
+    while (ramp.back() > seed_bits) {
+        mpfr_prec_t next = ramp.back() / 2 + SCHEDULE_GUARD_BITS;
+        ramp.push_back(next <= seed_bits + SCHEDULE_GUARD_BITS ? seed_bits : next);
+    }
+    std::reverse(ramp.begin(), ramp.end()); // ramp[0] == seed_bits, ramp.back() == target_bits
+    int steps = static_cast<int>(ramp.size()) - 1;
+    std::vector<mpfr_prec_t> precs(n + 1);
+    for (int i = 0; i <= n; ++i) {
+        precs[i] = ramp[std::max(0, i - (n - steps))];
+    }
+    return precs;
+}
+
+// Copy of v rounded to prec bits (result precision does not depend on set_default_prec)
+inline mpreal round_to_prec(const mpreal& v, mpfr_prec_t prec) {
+    mpreal r(0, prec);
+    mpfr_set(r.mpfr_ptr(), v.mpfr_srcptr(), MPFR_RNDN);
+    return r;
+}
+
+// Rounds v to prec bits in a fresh value and frees the old one (mpfr_prec_round keeps the memory)
+inline void shrink_value(mpreal& v, mpfr_prec_t prec) {
+    mpreal r(0, prec);
+    mpfr_set(r.mpfr_ptr(), v.mpfr_srcptr(), MPFR_RNDN);
+    mpfr_swap(v.mpfr_ptr(), r.mpfr_ptr());
+}
+
+// Early-termination rule for the kernels (--until-converged / --tol)
+struct StopRule {
+    bool enabled = false;
+    mpreal tol = mpreal(0, 64); // relative tolerance on |x_{n+1} - x_n| at target precision; 0 -> 2 ulps
+};
+
+// True when the step d = xnext - x is negligible at working precision p.
+// Below the target precision only the ulp test is used: it tells the kernel to move on to the next
+// precision level of the schedule rather than keep iterating a value that cannot improve.
+bool step_converged(const mpreal& d, const mpreal& xnext, mpfr_prec_t p, mpfr_prec_t target, const StopRule& stop) {
+    if (d == 0) return true;
+    if (xnext == 0) return false;
+    if (p < target || stop.tol == 0) {
+        // |d| < 2^(exp(xnext) - p + 1), i.e. within 2 ulps of xnext
+        return mpfr_get_exp(d.mpfr_srcptr()) <= mpfr_get_exp(xnext.mpfr_srcptr()) - p + 1;
+    }
+    return round_to_prec(abs(d), 64) <= stop.tol * round_to_prec(abs(xnext), 64);
+}
+
+// After iteration i (1-based) converged at precision p: stop at the target, otherwise skip the remaining
+// iterations scheduled at p. Returns false when the kernel should stop.
+bool advance_after_convergence(int& i, int iterations, const std::vector<mpfr_prec_t>& precs) {
+    mpfr_prec_t p = precs[i];
+    if (p == precs.back()) return false;
+    while (i < iterations && precs[i + 1] == p) ++i;
+    return true;
+}
+
+// Receives every iterate as it is produced: i = 0 is the seed, then one call per iteration run.
+// Kernels only hold the current and next iterate; keeping or printing history is up to the sink.
+using IterationSink = std::function<void(int i, const mpreal& value)>;
+
+// Kernel output: the final value and the number of iterations actually run
+struct KernelResult {
+    mpreal value;
+    int iterations_used = 0;
+};
+
+// Working storage for the kernels, which compute in place with mpfr_* calls instead of building
+// mpreal temporaries. mpfr_set_prec / mpfr_prec_round only reallocate when a value grows, so once a
+// scratch has seen the target precision the iteration loop does no allocation at all; keep one per
+// thread and pass it to every call (batch mode does).
+struct KernelScratch {
+    mpreal x, next, t, d, ap;
+
+    // Grow every slot to bits up front (needed before an ArenaScope opens, see GmpArena)
+    void reserve(mpfr_prec_t bits) {
+        for (mpreal* v : { &x, &next, &t, &d, &ap }) mpfr_set_prec(v->mpfr_ptr(), bits);
+    }
+};
+
+// a at working precision p: a itself when it already has that precision, else rounded into slot
+inline mpfr_srcptr a_at_prec(const mpreal& a, mpfr_prec_t p, mpreal& slot) {
+    if (mpfr_get_prec(a.mpfr_srcptr()) == p) return a.mpfr_srcptr();
+    mpfr_set_prec(slot.mpfr_ptr(), p);
+    mpfr_set(slot.mpfr_ptr(), a.mpfr_srcptr(), MPFR_RNDN);
+    return slot.mpfr_srcptr();
+}
+
+// Store v into slot at precision p
+inline void load_at_prec(mpreal& slot, const mpreal& v, mpfr_prec_t p) {
+    mpfr_set_prec(slot.mpfr_ptr(), p);
+    mpfr_set(slot.mpfr_ptr(), v.mpfr_srcptr(), MPFR_RNDN);
+}
+
+// Convergence test for the step from sc.x to sc.next (both at precision p); uses sc.d
+inline bool scratch_step_converged(KernelScratch& sc, mpfr_prec_t p, mpfr_prec_t target, const StopRule& stop) {
+    mpfr_set_prec(sc.d.mpfr_ptr(), p);
+    mpfr_sub(sc.d.mpfr_ptr(), sc.next.mpfr_srcptr(), sc.x.mpfr_srcptr(), MPFR_RNDN);
+    return step_converged(sc.d, sc.next, p, target, stop);
+}
+
+// Full-precision products of the division-free kernels: mpfr_mul / mpfr_sqr, or split over the
+// threads of the ParallelMul open on this thread when the operands are large enough (--threads in a
+// single run; defined after WorkStealingPool). big_div is heron's divide, the same as mpfr_div but
+// built from big_mul products when they would run in parallel.
+void big_mul(mpfr_ptr r, mpfr_srcptr x, mpfr_srcptr y);
+void big_sqr(mpfr_ptr r, mpfr_srcptr x);
+void big_div(mpfr_ptr q, mpfr_srcptr a, mpfr_srcptr x);
+
+// Newton/Heron iterations for sqrt(a): x_{n+1} = 0.5*(x_n + a/x_n)
+// precs comes from build_precision_schedule; each iterate carries the precision it ran at.
+// With stop.enabled the loop may end early (see iterations_used).
+KernelResult newton_heron(const mpreal& a, const mpreal& x0, int iterations, const std::vector<mpfr_prec_t>& precs, const StopRule& stop, const IterationSink& sink = nullptr, KernelScratch* scratch = nullptr) {
+    KernelScratch local;
+    KernelScratch& sc = scratch ? *scratch : local;
+    mpfr_ptr x = sc.x.mpfr_ptr(), next = sc.next.mpfr_ptr();
+    load_at_prec(sc.x, x0, precs[0]);
+    int used = 0;
+    if (sink) sink(used, sc.x);
+    for (int i = 0; i < iterations; ++i) {
+        mpfr_prec_t p = precs[i + 1];
+        TRACE_SCOPE("heron step", "iteration", p);
+        mpfr_prec_round(x, p, MPFR_RNDN); // widening is exact
+        if (mpfr_zero_p(x)) { // avoid division by zero
+            if (sink) sink(++used, sc.x); else ++used;
+            if (stop.enabled) break;
+            continue;
+        }
+        mpfr_srcptr ap = a_at_prec(a, p, sc.ap);
+        mpfr_set_prec(next, p);
+        big_div(next, ap, x);
+        mpfr_add(next, next, x, MPFR_RNDN);
+        mpfr_mul_2si(next, next, -1, MPFR_RNDN); // * 0.5, exact
+        if (sink) sink(++used, sc.next); else ++used;
+        bool done = stop.enabled && scratch_step_converged(sc, p, precs.back(), stop);
+        mpfr_swap(x, next);
+        if (done) {
+            int it = i + 1;
+            if (!advance_after_convergence(it, iterations, precs)) break;
+            i = it - 1;
+        }
+    }
+    return { sc.x, used };
+}
+
+// Reciprocal sqrt iterations y_{n+1} = y_n * (1.5 - 0.5 * a * y_n^2), computed in place as
+// y * ((3 - a*y^2) / 2); leaves y ~= 1/sqrt(a) in sc.x. Requires a > 0.
+// residual (--large): the same step as y + y * r / 2 with r = 1 - a*y^2. r is ~2^-k when y has k
+// correct bits, so only its leading p - k bits matter and the y * r product runs at that (about half)
+// precision: per step a full square, one full multiply and one half multiply instead of three full
+// products. k is read off the exponent of r, not the precision of y, so a fixed schedule (where y
+// already carries p bits, most of them wrong) still gets the cheap product sized to what it needs.
+int rsqrt_iterations(const mpreal& a, const mpreal& y0, int iterations, const std::vector<mpfr_prec_t>& precs, const StopRule& stop, const IterationSink& sink, KernelScratch& sc, bool residual = false) {
+    mpfr_ptr y = sc.x.mpfr_ptr(), next = sc.next.mpfr_ptr(), t = sc.t.mpfr_ptr(), d = sc.d.mpfr_ptr();
+    load_at_prec(sc.x, y0, precs[0]);
+    int used = 0;
+    if (sink) sink(used, sc.x);
+    for (int i = 0; i < iterations; ++i) {
+        mpfr_prec_t p = precs[i + 1];
+        TRACE_SCOPE(residual ? "rsqrt residual step" : "rsqrt step", "iteration", p);
+        mpfr_srcptr ap = a_at_prec(a, p, sc.ap);
+        mpfr_set_prec(t, p);
+        mpfr_set_prec(next, p);
+        bool done;
+        if (residual) {
+            big_sqr(t, y);
+            big_mul(t, t, ap);
+            mpfr_ui_sub(t, 1, t, MPFR_RNDN); // r, exact: a*y^2 ~= 1
+            mpfr_exp_t e = mpfr_zero_p(t) ? -p : mpfr_get_exp(t); // |r| < 2^e: y has ~-e correct bits
+            mpfr_prec_t c = std::min<mpfr_prec_t>(p, std::max<mpfr_prec_t>(p + e, 0) + SCHEDULE_GUARD_BITS);
+            mpfr_prec_round(t, c, MPFR_RNDN);
+            mpfr_set_prec(d, c);
+            mpfr_set(d, y, MPFR_RNDN);
+            big_mul(d, d, t);
+            mpfr_mul_2si(d, d, -1, MPFR_RNDN); // the step y_{n+1} - y_n
+            mpfr_add(next, y, d, MPFR_RNDN);
+            if (sink) sink(++used, sc.next); else ++used;
+            done = stop.enabled && step_converged(sc.d, sc.next, p, precs.back(), stop);
+        }
+        else {
+            mpfr_prec_round(y, p, MPFR_RNDN);
+            big_sqr(t, y);
+            big_mul(t, t, ap);
+            mpfr_ui_sub(t, 3, t, MPFR_RNDN);
+            mpfr_mul_2si(t, t, -1, MPFR_RNDN); // 1.5 - 0.5*a*y^2
+            big_mul(next, y, t);
+            if (sink) sink(++used, sc.next); else ++used;
+            done = stop.enabled && scratch_step_converged(sc, p, precs.back(), stop);
+        }
+        mpfr_swap(y, next);
+        if (done) {
+            int it = i + 1;
+            if (!advance_after_convergence(it, iterations, precs)) break;
+            i = it - 1;
+        }
+    }
+    return used;
+}
+
+// Reciprocal sqrt iterations: y_{n+1} = y_n * (1.5 - 0.5 * a * y_n^2), sqrt = a * y
+// The sink sees the y iterates.
+KernelResult reciprocal_sqrt(const mpreal& a, const mpreal& y0, int iterations, const std::vector<mpfr_prec_t>& precs, const StopRule& stop, const IterationSink& sink = nullptr, KernelScratch* scratch = nullptr) {
+    if (a == 0) { // 1/sqrt(0) does not exist (y would grow without bound); sqrt(0) = 0
+        if (sink) sink(0, round_to_prec(y0, precs[0]));
+        return { mpreal(0, a.getPrecision()), 0 };
+    }
+    KernelScratch local;
+    KernelScratch& sc = scratch ? *scratch : local;
+    int used = rsqrt_iterations(a, y0, iterations, precs, stop, sink, sc);
+    mpreal result(0, a.getPrecision());
+    big_mul(result.mpfr_ptr(), a.mpfr_srcptr(), sc.x.mpfr_srcptr()); // sqrt(a) = a * (1/sqrt(a))
+    return { result, used };
+}
+
+// Precision the Karp–Markstein rsqrt stage has to reach for a target_bits result
+inline mpfr_prec_t karp_half_prec(mpfr_prec_t target_bits) {
+    return std::min(target_bits, target_bits / 2 + SCHEDULE_GUARD_BITS);
+}
+
+// Karp–Markstein: reciprocal-sqrt iterations only up to ~half the target precision, then one
+// division-free correction  x = a*y,  sqrt(a) ~= x + (y/2) * (a - x^2)  that doubles the correct bits.
+// precs is the schedule for the rsqrt stage (its target is karp_half_prec(target_bits)); the sink
+// sees the y iterates, like reciprocal_sqrt. residual selects the --large rsqrt steps.
+KernelResult karp_sqrt(const mpreal& a, const mpreal& y0, int iterations, const std::vector<mpfr_prec_t>& precs, const StopRule& stop, mpfr_prec_t target_bits, const IterationSink& sink = nullptr, KernelScratch* scratch = nullptr, bool residual = false) {
+    if (a == 0) {
+        if (sink) sink(0, round_to_prec(y0, precs[0]));
+        return { mpreal(0, target_bits), 0 };
+    }
+    KernelScratch local;
+    KernelScratch& sc = scratch ? *scratch : local;
+    int used = rsqrt_iterations(a, y0, iterations, precs, stop, sink, sc, residual);
+    mpfr_ptr y = sc.x.mpfr_ptr(), x = sc.next.mpfr_ptr(), t = sc.t.mpfr_ptr();
+    mpfr_prec_t h = mpfr_get_prec(y);
+    TRACE_SCOPE("karp correction", "iteration", target_bits);
+
+    mpfr_set_prec(x, h);
+    big_mul(x, a_at_prec(a, h, sc.ap), y); // sqrt(a) to ~h bits
+    mpfr_prec_round(x, target_bits, MPFR_RNDN);
+    mpfr_set_prec(t, target_bits);
+    big_sqr(t, x);
+    mpfr_sub(t, a_at_prec(a, target_bits, sc.ap), t, MPFR_RNDN); // ~2^-h * a: only its leading h bits matter
+    mpfr_prec_round(t, h, MPFR_RNDN);
+    big_mul(t, t, y);
+    mpfr_mul_2si(t, t, -1, MPFR_RNDN);
+    mpfr_add(x, x, t, MPFR_RNDN);
+    return { sc.next, used };
+}
+
+// N-th roots (--root N): the Heron and rsqrt loops above with x^(N-1) / y^N in place of the square.
+//   root:         x_{k+1} = ((N-1) x_k + a / x_k^(N-1)) / N
+//   inverse root: y_{k+1} = y_k + y_k (1 - a y_k^N) / N, then a^(1/N) = a * y^(N-1)
+// Both converge quadratically like the N = 2 kernels, so the same precision schedules apply; they run
+// root_guard_bits(N) above the target, since y^(N-1) multiplies the error in y by about N, and round
+// once at the end. Powers go
+// through a Pow policy: StaticPow<N> unrolls exponentiation by squaring at compile time (cube, 4th and
+// 5th roots), RuntimePow loops over the bits of any N.
+
+inline mpfr_prec_t root_guard_bits(unsigned long n) {
+    mpfr_prec_t g = 4;
+    while (n) {
+        ++g;
+        n >>= 1;
+    }
+    return g;
+}
+
+// r = x^N, left-to-right binary powering unrolled by the compiler (r and x distinct)
+template<unsigned long N>
+void pow_static(mpfr_ptr r, mpfr_srcptr x) {
+    static_assert(N >= 1, "pow_static needs N >= 1");
+    if constexpr (N == 1) mpfr_set(r, x, MPFR_RNDN);
+    else if constexpr (N % 2 == 0) {
+        pow_static<N / 2>(r, x);
+        big_sqr(r, r);
+    }
+    else {
+        pow_static<N - 1>(r, x);
+        big_mul(r, r, x);
+    }
+}
+
+// r = x^n (n >= 1, r and x distinct)
+inline void pow_runtime(mpfr_ptr r, mpfr_srcptr x, unsigned long n) {
+    int top = 0;
+    while (top + 1 < static_cast<int>(sizeof(n) * CHAR_BIT) && (n >> (top + 1))) ++top;
+    mpfr_set(r, x, MPFR_RNDN);
+    for (int b = top - 1; b >= 0; --b) {
+        big_sqr(r, r);
+        if ((n >> b) & 1) big_mul(r, r, x);
+    }
+}
+
+template<unsigned long N>
+struct StaticPow {
+    unsigned long n() const { return N; }
+    void operator()(mpfr_ptr r, mpfr_srcptr x, unsigned long k) const { // k is N or N - 1
+        if (k == N) pow_static<N>(r, x);
+        else pow_static<N - 1>(r, x);
+    }
+};
+
+struct RuntimePow {
+    unsigned long root;
+    unsigned long n() const { return root; }
+    void operator()(mpfr_ptr r, mpfr_srcptr x, unsigned long k) const { pow_runtime(r, x, k); }
+};
+
+// a^(1/N) by Newton (the Heron structure of newton_heron); the sink sees the x iterates. precs targets
+// target_bits + root_guard_bits(N).
+template<class Pow>
+KernelResult root_newton(const Pow& pw, const mpreal& a, const mpreal& x0, int iterations, const std::vector<mpfr_prec_t>& precs, const StopRule& stop, mpfr_prec_t target_bits, const IterationSink& sink = nullptr, KernelScratch* scratch = nullptr) {
+    KernelScratch local;
+    KernelScratch& sc = scratch ? *scratch : local;
+    const unsigned long n = pw.n();
+    mpfr_ptr x = sc.x.mpfr_ptr(), next = sc.next.mpfr_ptr(), t = sc.t.mpfr_ptr();
+    load_at_prec(sc.x, x0, precs[0]);
+    int used = 0;
+    if (sink) sink(used, sc.x);
+    for (int i = 0; i < iterations; ++i) {
+        mpfr_prec_t p = precs[i + 1];
+        TRACE_SCOPE("root step", "iteration", p);
+        mpfr_prec_round(x, p, MPFR_RNDN); // widening is exact
+        if (mpfr_zero_p(x)) { // avoid division by zero
+            if (sink) sink(++used, sc.x); else ++used;
+            if (stop.enabled) break;
+            continue;
+        }
+        mpfr_srcptr ap = a_at_prec(a, p, sc.ap);
+        mpfr_set_prec(t, p);
+        mpfr_set_prec(next, p);
+        pw(t, x, n - 1);
+        big_div(next, ap, t);
+        mpfr_mul_ui(t, x, n - 1, MPFR_RNDN);
+        mpfr_add(next, next, t, MPFR_RNDN);
+        mpfr_div_ui(next, next, n, MPFR_RNDN);
+        if (sink) sink(++used, sc.next); else ++used;
+        bool done = stop.enabled && scratch_step_converged(sc, p, precs.back(), stop);
+        mpfr_swap(x, next);
+        if (done) {
+            int it = i + 1;
+            if (!advance_after_convergence(it, iterations, precs)) break;
+            i = it - 1;
+        }
+    }
+    return { round_to_prec(sc.x, target_bits), used };
+}
+
+// Division-free inverse N-th root iterations y_{n+1} = y_n + y_n * (1 - a*y_n^N) / N (the structure
+// of rsqrt_iterations); leaves y ~= a^(-1/N) in sc.x. Requires a > 0.
+template<class Pow>
+int inverse_root_iterations(const Pow& pw, const mpreal& a, const mpreal& y0, int iterations, const std::vector<mpfr_prec_t>& precs, const StopRule& stop, const IterationSink& sink, KernelScratch& sc) {
+    const unsigned long n = pw.n();
+    mpfr_ptr y = sc.x.mpfr_ptr(), next = sc.next.mpfr_ptr(), t = sc.t.mpfr_ptr();
+    load_at_prec(sc.x, y0, precs[0]);
+    int used = 0;
+    if (sink) sink(used, sc.x);
+    for (int i = 0; i < iterations; ++i) {
+        mpfr_prec_t p = precs[i + 1];
+        TRACE_SCOPE("inverse root step", "iteration", p);
+        mpfr_prec_round(y, p, MPFR_RNDN);
+        mpfr_srcptr ap = a_at_prec(a, p, sc.ap);
+        mpfr_set_prec(t, p);
+        mpfr_set_prec(next, p);
+        pw(t, y, n);
+        big_mul(t, t, ap);
+        mpfr_ui_sub(t, 1, t, MPFR_RNDN); // 1 - a*y^N
+        big_mul(t, t, y);
+        mpfr_div_ui(t, t, n, MPFR_RNDN);
+        mpfr_add(next, y, t, MPFR_RNDN);
+        if (sink) sink(++used, sc.next); else ++used;
+        bool done = stop.enabled && scratch_step_converged(sc, p, precs.back(), stop);
+        mpfr_swap(y, next);
+        if (done) {
+            int it = i + 1;
+            if (!advance_after_convergence(it, iterations, precs)) break;
+            i = it - 1;
+        }
+    }
+    return used;
+}
+
+// a^(1/N) through the inverse N-th root, a^(1/N) = a * y^(N-1); the sink sees the y iterates.
+// precs targets target_bits + root_guard_bits(N).
+template<class Pow>
+KernelResult root_recip(const Pow& pw, const mpreal& a, const mpreal& y0, int iterations, const std::vector<mpfr_prec_t>& precs, const StopRule& stop, mpfr_prec_t target_bits, const IterationSink& sink = nullptr, KernelScratch* scratch = nullptr) {
+    if (a == 0) {
+        if (sink) sink(0, round_to_prec(y0, precs[0]));
+        return { mpreal(0, target_bits), 0 };
+    }
+    KernelScratch local;
+    KernelScratch& sc = scratch ? *scratch : local;
+    const unsigned long n = pw.n();
+    int used = inverse_root_iterations(pw, a, y0, iterations, precs, stop, sink, sc);
+    mpfr_ptr y = sc.x.mpfr_ptr(), t = sc.t.mpfr_ptr(), next = sc.next.mpfr_ptr();
+    mpfr_prec_t p = mpfr_get_prec(y);
+    mpfr_set_prec(t, p);
+    mpfr_set_prec(next, p);
+    pw(t, y, n - 1);
+    big_mul(next, a_at_prec(a, p, sc.ap), t); // a^(1/N) = a * y^(N-1)
+    return { round_to_prec(sc.next, target_bits), used };
+}
+
+// --inverse: a^(-1/N) itself, the iteration's y rounded once to target_bits (+inf for a = 0)
+template<class Pow>
+KernelResult root_inverse(const Pow& pw, const mpreal& a, const mpreal& y0, int iterations, const std::vector<mpfr_prec_t>& precs, const StopRule& stop, mpfr_prec_t target_bits, const IterationSink& sink = nullptr, KernelScratch* scratch = nullptr) {
+    if (a == 0) {
+        if (sink) sink(0, round_to_prec(y0, precs[0]));
+        mpreal inf(0, target_bits);
+        mpfr_set_inf(inf.mpfr_ptr(), 1);
+        return { inf, 0 };
+    }
+    KernelScratch local;
+    KernelScratch& sc = scratch ? *scratch : local;
+    int used = inverse_root_iterations(pw, a, y0, iterations, precs, stop, sink, sc);
+    return { round_to_prec(sc.x, target_bits), used };
+}
+
+// Runtime N for root_inverse: StaticPow for N = 2..5, RuntimePow beyond
+KernelResult inverse_nth_root(unsigned long n, const mpreal& a, const mpreal& y0, int iterations, const std::vector<mpfr_prec_t>& precs, const StopRule& stop, mpfr_prec_t target_bits, const IterationSink& sink = nullptr, KernelScratch* scratch = nullptr) {
+    switch (n) {
+    case 2: return root_inverse(StaticPow<2>(), a, y0, iterations, precs, stop, target_bits, sink, scratch);
+    case 3: return root_inverse(StaticPow<3>(), a, y0, iterations, precs, stop, target_bits, sink, scratch);
+    case 4: return root_inverse(StaticPow<4>(), a, y0, iterations, precs, stop, target_bits, sink, scratch);
+    case 5: return root_inverse(StaticPow<5>(), a, y0, iterations, precs, stop, target_bits, sink, scratch);
+    default: return root_inverse(RuntimePow{ n }, a, y0, iterations, precs, stop, target_bits, sink, scratch);
+    }
+}
+
+// nth_root<N>: compile-time powers; the kernel runs root_newton (inverse = false) or root_recip
+template<unsigned long N>
+KernelResult nth_root(bool inverse, const mpreal& a, const mpreal& seed, int iterations, const std::vector<mpfr_prec_t>& precs, const StopRule& stop, mpfr_prec_t target_bits, const IterationSink& sink = nullptr, KernelScratch* scratch = nullptr) {
+    static_assert(N >= 2, "nth_root needs N >= 2");
+    StaticPow<N> pw;
+    return inverse ? root_recip(pw, a, seed, iterations, precs, stop, target_bits, sink, scratch)
+                   : root_newton(pw, a, seed, iterations, precs, stop, target_bits, sink, scratch);
+}
+
+// Runtime N: the specialised kernels for N = 2..5, RuntimePow beyond
+KernelResult nth_root(unsigned long n, bool inverse, const mpreal& a, const mpreal& seed, int iterations, const std::vector<mpfr_prec_t>& precs, const StopRule& stop, mpfr_prec_t target_bits, const IterationSink& sink = nullptr, KernelScratch* scratch = nullptr) {
+    switch (n) {
+    case 2: return nth_root<2>(inverse, a, seed, iterations, precs, stop, target_bits, sink, scratch);
+    case 3: return nth_root<3>(inverse, a, seed, iterations, precs, stop, target_bits, sink, scratch);
+    case 4: return nth_root<4>(inverse, a, seed, iterations, precs, stop, target_bits, sink, scratch);
+    case 5: return nth_root<5>(inverse, a, seed, iterations, precs, stop, target_bits, sink, scratch);
+    default: break;
+    }
+    RuntimePow pw{ n };
+    return inverse ? root_recip(pw, a, seed, iterations, precs, stop, target_bits, sink, scratch)
+                   : root_newton(pw, a, seed, iterations, precs, stop, target_bits, sink, scratch);
+}
+
+// Fixed-limb kernels: targets up to FIXED_MAX_BITS (most batch inputs) run heron / recip instantiated
+// per limb count N. Every iterate is an mpfr_t over a stack array of N limbs (MPFR custom interface),
+// so a call does no allocation and no mpfr_set_prec, and the iteration count is a compile-time
+// constant: just enough steps to take the double seed to N limbs, each doubling the correct bits at
+// the precision of a doubling ramp. The ramp ends SCHEDULE_GUARD_BITS above the target (a spare limb
+// holds them) and is rounded once, so the result is nearly always the correctly rounded sqrt.
+// Used by --tier fixed / auto when no iterates are shown.
+constexpr mpfr_prec_t FIXED_MIN_BITS = 128; // size classes: 128, 256, 512, 1024 bits
+constexpr mpfr_prec_t FIXED_MAX_BITS = 1024;
+constexpr mpfr_prec_t FIXED_SEED_BITS = SEED_PREC_BITS - 1; // the double seeds may be 1 ulp off
+
+// ceil(log2(limb_bits / FIXED_SEED_BITS)) doublings
+constexpr int fixed_iterations(mpfr_prec_t limb_bits) {
+    int n = 0;
+    for (mpfr_prec_t b = FIXED_SEED_BITS; b < limb_bits; b *= 2) ++n;
+    return n;
+}
+
+// Size class (bits) of the fixed kernel that holds a bits-bit target; 0 above FIXED_MAX_BITS
+inline mpfr_prec_t fixed_size_bits(mpfr_prec_t bits) {
+    if (bits > FIXED_MAX_BITS) return 0;
+    mpfr_prec_t s = FIXED_MIN_BITS;
+    while (s < bits) s *= 2;
+    return s;
+}
+
+// Stack slots for the fixed kernels; at(k, p) hands out slot k as a fresh variable of precision p
+template<int N>
+struct FixedSlots {
+    mp_limb_t limbs[3][N];
+    mpfr_t v[3];
+
+    mpfr_ptr at(int k, mpfr_prec_t p) {
+        mpfr_custom_init(limbs[k], p);
+        mpfr_custom_init_set(v[k], MPFR_ZERO_KIND, 0, p, limbs[k]);
+        return v[k];
+    }
+};
+
+// precs[K - 1] = p, each earlier step at half the next one plus guard bits (as the doubling schedule)
+template<int K>
+void fixed_ramp(mpfr_prec_t (&precs)[K], mpfr_prec_t p) {
+    precs[K - 1] = p;
+    for (int i = K - 1; i > 0; --i) precs[i - 1] = std::min(p, std::max(SEED_PREC_BITS, precs[i] / 2 + SCHEDULE_GUARD_BITS));
+}
+
+// Heron on N stack limbs: x_{n+1} = 0.5*(x_n + a/x_n). bits <= N * GMP_NUMB_BITS; a > 0 or a == 0.
+template<int N>
+KernelResult fixed_heron(const mpreal& a, const mpreal& x0, mpfr_prec_t bits) {
+    constexpr int K = fixed_iterations(N * GMP_NUMB_BITS + SCHEDULE_GUARD_BITS);
+    if (mpfr_zero_p(a.mpfr_srcptr())) return { mpreal(0, bits), 0 };
+    FixedSlots<N + 1> s; // one spare limb holds the guard bits
+    mpfr_prec_t precs[K];
+    fixed_ramp(precs, bits + SCHEDULE_GUARD_BITS);
+    mpfr_ptr x = s.at(0, SEED_PREC_BITS);
+    mpfr_set(x, x0.mpfr_srcptr(), MPFR_RNDN);
+    for (int i = 0; i < K; ++i) { // constant trip count: unrolled, no convergence test
+        mpfr_ptr next = s.at((i + 1) & 1, precs[i]);
+        mpfr_div(next, a.mpfr_srcptr(), x, MPFR_RNDN);
+        mpfr_add(next, next, x, MPFR_RNDN);
+        mpfr_mul_2si(next, next, -1, MPFR_RNDN);
+        x = next;
+    }
+    mpreal r(0, bits);
+    mpfr_set(r.mpfr_ptr(), x, MPFR_RNDN);
+    return { r, K };
+}
+
+// Reciprocal sqrt on N stack limbs, y_{n+1} = y_n * ((3 - a*y_n^2) / 2), then sqrt(a) = a * y
+template<int N>
+KernelResult fixed_recip(const mpreal& a, const mpreal& y0, mpfr_prec_t bits) {
+    constexpr int K = fixed_iterations(N * GMP_NUMB_BITS + SCHEDULE_GUARD_BITS);
+    if (mpfr_zero_p(a.mpfr_srcptr())) return { mpreal(0, bits), 0 };
+    FixedSlots<N + 1> s; // one spare limb holds the guard bits
+    mpfr_prec_t precs[K];
+    fixed_ramp(precs, bits + SCHEDULE_GUARD_BITS);
+    mpfr_ptr y = s.at(0, SEED_PREC_BITS);
+    mpfr_set(y, y0.mpfr_srcptr(), MPFR_RNDN);
+    for (int i = 0; i < K; ++i) {
+        mpfr_ptr t = s.at(2, precs[i]), next = s.at((i + 1) & 1, precs[i]);
+        mpfr_sqr(t, y, MPFR_RNDN);
+        mpfr_mul(t, t, a.mpfr_srcptr(), MPFR_RNDN);
+        mpfr_ui_sub(t, 3, t, MPFR_RNDN);
+        mpfr_mul_2si(t, t, -1, MPFR_RNDN);
+        mpfr_mul(next, y, t, MPFR_RNDN);
+        y = next;
+    }
+    mpreal r(0, bits);
+    mpfr_mul(r.mpfr_ptr(), a.mpfr_srcptr(), y, MPFR_RNDN);
+    return { r, K };
+}
+
+// Runtime precision -> instantiation. seed is x0 for heron, y0 for recip; bits <= FIXED_MAX_BITS.
+KernelResult fixed_kernel(bool heron, const mpreal& a, const mpreal& seed, mpfr_prec_t bits) {
+    constexpr int L = FIXED_MIN_BITS / GMP_NUMB_BITS;
+    switch (fixed_size_bits(bits)) {
+    case FIXED_MIN_BITS:     return heron ? fixed_heron<L>(a, seed, bits) : fixed_recip<L>(a, seed, bits);
+    case 2 * FIXED_MIN_BITS: return heron ? fixed_heron<2 * L>(a, seed, bits) : fixed_recip<2 * L>(a, seed, bits);
+    case 4 * FIXED_MIN_BITS: return heron ? fixed_heron<4 * L>(a, seed, bits) : fixed_recip<4 * L>(a, seed, bits);
+    default:                 return heron ? fixed_heron<8 * L>(a, seed, bits) : fixed_recip<8 * L>(a, seed, bits);
+    }
+}
+
+// Split a > 0 as m * 2^e with e a multiple of n and m in [0.5, 2^(n-1)), m rounded to a double
+// (leading 53 bits), so that a^(1/n) = m^(1/n) * 2^(e/n) with both factors cheap to evaluate
+void split_exponent(mpfr_srcptr a, unsigned long n, double& m, long& e) {
+    m = mpfr_get_d_2exp(&e, a, MPFR_RNDN); // m in [0.5, 1)
+    long r = e % static_cast<long>(n);
+    if (r < 0) r += static_cast<long>(n);
+    m = std::ldexp(m, static_cast<int>(r));
+    e -= r;
+}
+
+// n = 2: e even and m in [0.5, 2), so that sqrt(a) = sqrt(m) * 2^(e/2)
+void split_even_exponent(mpfr_srcptr a, double& m, long& e) {
+    split_exponent(a, 2, m, e);
+}
+
+// Create an automatic initial guess from the binary exponent and the leading mantissa bits:
+// no full-precision log/pow, and the seed is correct to ~53 bits instead of ~1. The automatic seeds
+// are stored at SEED_PREC_BITS; the kernels raise them to the first schedule precision (load_at_prec).
+mpreal auto_initial_guess(const mpreal& a) {
+    if (a == 0) return mpreal(0, SEED_PREC_BITS);
+    if (a < 0) {
+        throw std::runtime_error("auto_initial_guess: negative input");
+    }
+    double m;
+    long e;
+    split_even_exponent(a.mpfr_srcptr(), m, e);
+    mpreal x0(std::sqrt(m), SEED_PREC_BITS);
+    mpfr_mul_2si(x0.mpfr_ptr(), x0.mpfr_srcptr(), e / 2, MPFR_RNDN); // exact
+    return x0;
+}
+
+// Same seed for the reciprocal-sqrt methods, 1/sqrt(m) * 2^(-e/2), without a full-precision 1/x0
+mpreal auto_initial_rsqrt_guess(const mpreal& a) {
+    if (a == 0) {
+        throw std::runtime_error("auto_initial_rsqrt_guess: zero input");
+    }
+    if (a < 0) {
+        throw std::runtime_error("auto_initial_rsqrt_guess: negative input");
+    }
+    double m;
+    long e;
+    split_even_exponent(a.mpfr_srcptr(), m, e);
+    mpreal y0(1.0 / std::sqrt(m), SEED_PREC_BITS);
+    mpfr_mul_2si(y0.mpfr_ptr(), y0.mpfr_srcptr(), -(e / 2), MPFR_RNDN); // exact
+    return y0;
+}
+
+// --root N seeds, built the same way: m^(1/N) * 2^(e/N) and its reciprocal
+mpreal auto_initial_root_guess(const mpreal& a, unsigned long n, bool inverse) {
+    if (a == 0) {
+        if (inverse) throw std::runtime_error("auto_initial_root_guess: zero input");
+        return mpreal(0, SEED_PREC_BITS);
+    }
+    if (a < 0) {
+        throw std::runtime_error("auto_initial_root_guess: negative input");
+    }
+    double m;
+    long e;
+    split_exponent(a.mpfr_srcptr(), n, m, e);
+    double r = n == 3 ? std::cbrt(m) : std::pow(m, 1.0 / static_cast<double>(n));
+    mpreal x0(inverse ? 1.0 / r : r, SEED_PREC_BITS);
+    long k = e / static_cast<long>(n);
+    mpfr_mul_2si(x0.mpfr_ptr(), x0.mpfr_srcptr(), inverse ? -k : k, MPFR_RNDN); // exact
+    return x0;
+}
+
+// Batch API ----------------------------------------------------------------------------------------
+// For embedding the engine as a library (compile with -DMPREAL_SQRT_NO_MAIN): sqrt over a whole array
+// of inputs. Values are stored structure-of-arrays and the recurrence runs in lockstep, one step over
+// the whole batch before the next, so the loop body stays hot and the mantissas stream through memory.
+
+// n MPFR values of one precision in two allocations: the mpfr_t headers in one array and every
+// mantissa in one contiguous limb buffer (MPFR custom interface). data() is an array of n mpfr_t for
+// the pointer form of sqrt_batch. Move-only: the headers point into the limb buffer.
+class MpfrArray {
+public:
+    MpfrArray(size_t n, mpfr_prec_t prec)
+        : prec_(prec), stride_(mpfr_custom_get_size(prec) / sizeof(mp_limb_t)), limbs_(n * stride_), v_(n) {
+        for (size_t i = 0; i < n; ++i) view(i, prec);
+    }
+    MpfrArray(MpfrArray&&) = default;
+    MpfrArray& operator=(MpfrArray&&) = default;
+    MpfrArray(const MpfrArray&) = delete;
+    MpfrArray& operator=(const MpfrArray&) = delete;
+
+    size_t size() const { return v_.size(); }
+    mpfr_prec_t prec() const { return prec_; }
+    mpfr_ptr operator[](size_t i) { return &v_[i]; }
+    mpfr_srcptr operator[](size_t i) const { return &v_[i]; }
+    __mpfr_struct* data() { return v_.data(); }
+    const __mpfr_struct* data() const { return v_.data(); }
+
+    // Element i as a fresh zero of precision p <= prec()
+    mpfr_ptr view(size_t i, mpfr_prec_t p) {
+        mp_limb_t* m = limbs_.data() + i * stride_;
+        mpfr_custom_init(m, p);
+        mpfr_custom_init_set(&v_[i], MPFR_ZERO_KIND, 0, p, m);
+        return &v_[i];
+    }
+
+private:
+    mpfr_prec_t prec_;
+    size_t stride_; // limbs per value
+    std::vector<mp_limb_t> limbs_;
+    std::vector<__mpfr_struct> v_;
+};
+
+// out[i] = sqrt(in[i]) for i < n by method "heron" or "recip", at working precision prec plus
+// SCHEDULE_GUARD_BITS and rounded once into out[i] at out[i]'s own precision. Every input runs the
+// same doubling ramp of fixed_iterations steps (as the fixed-limb kernels), so no element needs a
+// convergence test. Zero, infinity, NaN and negative inputs get mpfr_sqrt's answer. out may be in.
+void sqrt_batch(const __mpfr_struct* in, __mpfr_struct* out, size_t n, mpfr_prec_t prec, const std::string& method = "heron") {
+    bool heron = method != "recip";
+    mpfr_prec_t p = prec + SCHEDULE_GUARD_BITS;
+    int steps = fixed_iterations(p);
+    std::vector<mpfr_prec_t> precs = build_precision_schedule("doubling", p, steps);
+    std::vector<size_t> live; // regular positive inputs
+    live.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        if (mpfr_regular_p(&in[i]) && mpfr_sgn(&in[i]) > 0) live.push_back(i);
+        else mpfr_sqrt(&out[i], &in[i], MPFR_RNDN);
+    }
+    size_t m = live.size();
+    MpfrArray cur(m, p), next(m, p), t(1, p);
+    for (size_t k = 0; k < m; ++k) { // the auto_initial_guess / auto_initial_rsqrt_guess seeds
+        double d;
+        long e;
+        split_even_exponent(&in[live[k]], d, e);
+        mpfr_ptr x = cur.view(k, SEED_PREC_BITS);
+        mpfr_set_d(x, heron ? std::sqrt(d) : 1.0 / std::sqrt(d), MPFR_RNDN);
+        mpfr_mul_2si(x, x, heron ? e / 2 : -(e / 2), MPFR_RNDN);
+    }
+    for (int s = 1; s <= steps; ++s) {
+        mpfr_prec_t ps = precs[s];
+        for (size_t k = 0; k < m; ++k) {
+            mpfr_srcptr a = &in[live[k]], x = cur[k];
+            mpfr_ptr nx = next.view(k, ps);
+            if (heron) {
+                mpfr_div(nx, a, x, MPFR_RNDN);
+                mpfr_add(nx, nx, x, MPFR_RNDN);
+                mpfr_mul_2si(nx, nx, -1, MPFR_RNDN);
+            }
+            else {
+                mpfr_ptr tt = t.view(0, ps);
+                mpfr_sqr(tt, x, MPFR_RNDN);
+                mpfr_mul(tt, tt, a, MPFR_RNDN);
+                mpfr_ui_sub(tt, 3, tt, MPFR_RNDN);
+                mpfr_mul_2si(tt, tt, -1, MPFR_RNDN);
+                mpfr_mul(nx, x, tt, MPFR_RNDN);
+            }
+        }
+        std::swap(cur, next);
+    }
+    for (size_t k = 0; k < m; ++k) {
+        size_t i = live[k];
+        if (heron) mpfr_set(&out[i], cur[k], MPFR_RNDN);
+        else mpfr_mul(&out[i], &in[i], cur[k], MPFR_RNDN);
+    }
+}
+
+// Same on two MpfrArrays, at out's precision
+void sqrt_batch(const MpfrArray& in, MpfrArray& out, const std::string& method = "heron") {
+    sqrt_batch(in.data(), out.data(), std::min(in.size(), out.size()), out.prec(), method);
+}
+
+// Integer path -------------------------------------------------------------------------------------
+
+// mpz_t tied to a scope
+struct Mpz {
+    mpz_t v;
+    Mpz() { mpz_init(v); }
+    ~Mpz() { mpz_clear(v); }
+    Mpz(const Mpz&) = delete;
+    Mpz& operator=(const Mpz&) = delete;
+
+    void release() { mpz_realloc2(v, GMP_NUMB_BITS); } // value -> 0, memory back to GMP
+};
+
+// Decimal integer literal ([+]digits): the inputs the integer path applies to. "4.0" or "1e2" are
+// not taken, so their results keep coming from the floating kernels.
+bool parse_integer(const std::string& s, mpz_t out) {
+    size_t b = (!s.empty() && s[0] == '+') ? 1 : 0;
+    if (b >= s.size()) return false;
+    for (size_t i = b; i < s.size(); ++i) {
+        if (s[i] < '0' || s[i] > '9') return false;
+    }
+    return mpz_set_str(out, s.c_str() + b, 10) == 0;
+}
+
+// Cheap rejection before mpz_perfect_square_p: only 44 of the 256 residues mod 256 are squares, read
+// straight off the low limb (GMP then applies its own residue tests before any root is taken)
+bool maybe_square(const mpz_t n) {
+    static const std::array<bool, 256> square_mod256 = []() {
+        std::array<bool, 256> t{};
+        for (unsigned i = 0; i < 256; ++i) t[(i * i) & 255] = true;
+        return t;
+    }();
+    return square_mod256[mpz_getlimbn(n, 0) & 255];
+}
+
+// Exact root when number is a perfect-square integer literal (a perfect n-th power for n != 2)
+bool exact_integer_root(const std::string& number, mpz_t root, unsigned long n = 2) {
+    Mpz v;
+    if (!parse_integer(number, v.v)) return false;
+    if (n != 2) return mpz_root(root, v.v, n) != 0;
+    if (!maybe_square(v.v) || !mpz_perfect_square_p(v.v)) return false;
+    mpz_sqrt(root, v.v);
+    return true;
+}
+
+// --mode isqrt: s = floor(sqrt(n)), r = n - s^2; false when number is not a non-negative integer
+bool integer_sqrtrem(const std::string& number, mpz_t s, mpz_t r) {
+    Mpz n;
+    if (!parse_integer(number, n.v)) return false;
+    mpz_sqrtrem(s, r, n.v);
+    return true;
+}
+
+std::string mpz_to_string(const mpz_t z) {
+    std::vector<char> buf(mpz_sizeinbase(z, 10) + 2);
+    mpz_get_str(buf.data(), 10, z);
+    return std::string(buf.data());
+}
+
+// Decimal output path: one mpfr_get_str per value into a reused buffer (GMP's radix conversion is
+// divide-and-conquer, so this is subquadratic), written to the stream in one call. The text matches
+// operator<< under std::scientific with setprecision(digits): d.<digits>e+XX.
+class DecimalFormatter {
+public:
+    explicit DecimalFormatter(size_t digits = 0) : digits_(digits) {}
+
+    void set_digits(size_t digits) { digits_ = digits; }
+
+    void write(std::ostream& os, const mpreal& v) {
+        mpfr_srcptr x = v.mpfr_srcptr();
+        if (mpfr_nan_p(x)) { os << "nan"; return; }
+        if (mpfr_inf_p(x)) { os << (mpfr_signbit(x) ? "-inf" : "inf"); return; }
+        TRACE_SCOPE("decimal", "output", mpfr_get_prec(x));
+        size_t n = digits_ + 1; // significant digits
+        out_.clear();
+        long exp10 = 0;
+        if (mpfr_zero_p(x)) {
+            if (mpfr_signbit(x)) out_ += '-';
+            out_.append(n, '0');
+        }
+        else {
+            if (buf_.size() < n + 2) buf_.resize(std::max<size_t>(n + 2, 7));
+            mpfr_exp_t e;
+            mpfr_get_str(buf_.data(), &e, 10, n, x, MPFR_RNDN);
+            out_ += buf_.data();
+            exp10 = static_cast<long>(e) - 1;
+        }
+        size_t lead = (out_[0] == '-') ? 1 : 0;
+        if (digits_ > 0) out_.insert(lead + 1, 1, '.');
+        char ebuf[32];
+        std::snprintf(ebuf, sizeof(ebuf), "e%c%02ld", exp10 < 0 ? '-' : '+', std::labs(exp10));
+        out_ += ebuf;
+        os.write(out_.data(), static_cast<std::streamsize>(out_.size()));
+    }
+
+    // Stream adaptor: os << dec(v)
+    struct Value {
+        DecimalFormatter* f;
+        const mpreal* v;
+        friend std::ostream& operator<<(std::ostream& os, const Value& d) {
+            d.f->write(os, *d.v);
+            return os;
+        }
+    };
+    Value operator()(const mpreal& v) { return Value{ this, &v }; }
+
+private:
+    size_t digits_;
+    std::vector<char> buf_;
+    std::string out_;
+};
+
+// DecimalFormatter's text for values too large to convert in one piece (--mem-limit): the rounded
+// significand is formed exactly as an integer (ties to even, as mpfr_get_str) and written out by
+// recursive halving in blocks of DECIMAL_CHUNK_DIGITS, so the full digit string never exists.
+constexpr size_t DECIMAL_CHUNK_DIGITS = size_t(1) << 16;
+
+// Exactly width digits of m (0 <= m < 10^width), zero-padded on the left. m is consumed.
+void write_digits_chunked(mpz_t m, size_t width, const std::function<void(const char*, size_t)>& emit) {
+    if (width <= DECIMAL_CHUNK_DIGITS) {
+        std::vector<char> buf(width + 2);
+        mpz_get_str(buf.data(), 10, m);
+        size_t len = std::strlen(buf.data());
+        std::string pad(width - std::min(width, len), '0');
+        emit(pad.data(), pad.size());
+        emit(buf.data(), len);
+        return;
+    }
+    size_t low = width / 2;
+    Mpz q, r;
+    {
+        Mpz pow;
+        mpz_ui_pow_ui(pow.v, 10, low);
+        mpz_tdiv_qr(q.v, r.v, m, pow.v);
+    }
+    mpz_realloc2(m, GMP_NUMB_BITS); // the halves hold it now
+    write_digits_chunked(q.v, width - low, emit);
+    q.release();
+    write_digits_chunked(r.v, low, emit);
+}
+
+// out = round(m * 2^f * 10^k), m >= 0, ties to even
+void scaled_round(mpz_t out, const mpz_t m, long f, long k) {
+    Mpz num, den, r;
+    mpz_ui_pow_ui(num.v, 10, static_cast<unsigned long>(std::max(0L, k)));
+    mpz_mul(num.v, num.v, m);
+    mpz_mul_2exp(num.v, num.v, static_cast<mp_bitcnt_t>(std::max(0L, f)));
+    if (k >= 0) { // the usual case: the divisor is 2^-f, so shift instead of dividing
+        mp_bitcnt_t sh = static_cast<mp_bitcnt_t>(std::max(0L, -f));
+        bool up = sh > 0 && mpz_tstbit(num.v, sh - 1)
+            && (mpz_scan1(num.v, 0) < sh - 1 || mpz_tstbit(num.v, sh)); // above half, or a tie and odd
+        mpz_tdiv_q_2exp(out, num.v, sh);
+        if (up) mpz_add_ui(out, out, 1);
+        return;
+    }
+    mpz_ui_pow_ui(den.v, 10, static_cast<unsigned long>(std::max(0L, -k)));
+    mpz_mul_2exp(den.v, den.v, static_cast<mp_bitcnt_t>(std::max(0L, -f)));
+    mpz_tdiv_qr(out, r.v, num.v, den.v);
+    num.release();
+    mpz_mul_2exp(r.v, r.v, 1);
+    int c = mpz_cmp(r.v, den.v);
+    if (c > 0 || (c == 0 && mpz_odd_p(out))) mpz_add_ui(out, out, 1);
+}
+
+// Writes x like DecimalFormatter(digits).write
+void write_decimal_chunked(std::ostream& os, mpfr_srcptr x, size_t digits) {
+    if (!mpfr_number_p(x)) {
+        DecimalFormatter(digits).write(os, mpreal(x));
+        return;
+    }
+    TRACE_SCOPE("decimal (chunked)", "output", mpfr_get_prec(x));
+    size_t n = digits + 1; // significant digits
+    if (mpfr_signbit(x)) os.put('-');
+    bool first = true;
+    auto emit = [&](const char* p, size_t len) {
+        if (first && len) {
+            os.put(p[0]);
+            if (digits > 0) os.put('.');
+            ++p;
+            --len;
+            first = false;
+        }
+        os.write(p, static_cast<std::streamsize>(len));
+    };
+    long exp10 = 0;
+    if (mpfr_zero_p(x)) {
+        std::string zeros(std::min(n, DECIMAL_CHUNK_DIGITS), '0');
+        for (size_t left = n; left > 0; left -= std::min(left, zeros.size())) emit(zeros.data(), std::min(left, zeros.size()));
+    }
+    else {
+        Mpz m, sig, lim;
+        long f = static_cast<long>(mpfr_get_z_2exp(m.v, x)); // |x| = m * 2^f
+        mpz_abs(m.v, m.v);
+        // 10^exp10 <= |x| < 10^(exp10 + 1): estimate from the binary exponent, then correct
+        exp10 = static_cast<long>(std::floor((mpfr_get_exp(x) - 1) * 0.30102999566398119521));
+        for (;;) {
+            scaled_round(sig.v, m.v, f, static_cast<long>(n) - 1 - exp10);
+            mpz_ui_pow_ui(lim.v, 10, n - 1);
+            if (mpz_cmp(sig.v, lim.v) < 0) { --exp10; continue; }
+            mpz_mul_ui(lim.v, lim.v, 10);
+            if (mpz_cmp(sig.v, lim.v) >= 0) { ++exp10; continue; }
+            break;
+        }
+        m.release();
+        lim.release();
+        write_digits_chunked(sig.v, n, emit);
+    }
+    char ebuf[32];
+    std::snprintf(ebuf, sizeof(ebuf), "e%c%02ld", exp10 < 0 ? '-' : '+', std::labs(exp10));
+    os << ebuf;
+}
+
+// Errors only need a few significant digits: they are computed at ERROR_PREC_BITS and printed short
+constexpr mpfr_prec_t ERROR_PREC_BITS = 64;
+constexpr size_t ERROR_PRINT_DIGITS = 5; // digits after the point, as in 1.23457e-50
+
+// Errors of one iterate against the reference
+struct IterateError {
+    mpreal abs_err = mpreal(0, ERROR_PREC_BITS);
+    mpreal rel_err = mpreal(0, ERROR_PREC_BITS);
+};
+
+// Computes each iterate's error once, for the table and every writer. mpfr_sub rounds the exact
+// difference straight into the 64-bit result, so the cancellation needs no full-precision temporary;
+// the relative error divides by |reference| rounded to 64 bits once up front. --serve passes the
+// working precision instead, since its responses print errors at every digit (as app.py's mpmath path).
+class ErrorMeter {
+public:
+    explicit ErrorMeter(const mpreal& reference, mpfr_prec_t prec = ERROR_PREC_BITS)
+        : reference_(reference), ref_abs_(0, prec) {
+        mpfr_set_prec(e_.abs_err.mpfr_ptr(), prec);
+        mpfr_set_prec(e_.rel_err.mpfr_ptr(), prec);
+        mpfr_abs(ref_abs_.mpfr_ptr(), reference.mpfr_srcptr(), MPFR_RNDN);
+    }
+
+    // Valid until the next call
+    const IterateError& operator()(const mpreal& val) {
+        mpfr_sub(e_.abs_err.mpfr_ptr(), val.mpfr_srcptr(), reference_.mpfr_srcptr(), MPFR_RNDN);
+        mpfr_abs(e_.abs_err.mpfr_ptr(), e_.abs_err.mpfr_srcptr(), MPFR_RNDN);
+        if (mpfr_zero_p(ref_abs_.mpfr_srcptr())) mpfr_set_zero(e_.rel_err.mpfr_ptr(), 1);
+        else mpfr_div(e_.rel_err.mpfr_ptr(), e_.abs_err.mpfr_srcptr(), ref_abs_.mpfr_srcptr(), MPFR_RNDN);
+        return e_;
+    }
+
+private:
+    const mpreal& reference_;
+    mpreal ref_abs_;
+    IterateError e_;
+};
+
+// Streams iterations to CSV as they are produced: iteration,value,abs_error,rel_error,prec_bits
+// (error columns are left empty when there is no reference)
+class IterationCsvWriter {
+public:
+    IterationCsvWriter(const std::string& file, size_t print_digits)
+        : ofs_(file), dec_(print_digits), err_dec_(ERROR_PRINT_DIGITS) {
+        if (!ofs_) {
+            std::cerr << "Could not open file for writing: " << file << "\n";
+            return;
+        }
+        ofs_ << "iteration,value,abs_error,rel_error,prec_bits" << '\n';
+    }
+
+    bool ok() const { return static_cast<bool>(ofs_); }
+
+    void write(int i, const mpreal& val, const IterateError* e) {
+        if (!ofs_) return;
+        ofs_ << i << "," << dec_(val) << ",";
+        if (e) {
+            ofs_ << err_dec_(e->abs_err) << "," << err_dec_(e->rel_err);
+        }
+        else {
+            ofs_ << ",";
+        }
+        ofs_ << "," << val.getPrecision() << '\n';
+    }
+
+private:
+    std::ofstream ofs_;
+    DecimalFormatter dec_, err_dec_;
+};
+
+// --save-bin format: fixed-size little structs in native byte order, so a reader can mmap the file
+// and index records directly (record i starts at header_size + i * record_size).
+//   BinFileHeader, then per iterate: BinRecordHeader followed by limbs_per_record limbs.
+// A value is sign * 0.L[n-1]...L[0] * 2^exponent with L[n-1] as the most significant limb (MPFR's
+// own significand layout). Iterates computed below the target precision (--precision-schedule
+// doubling) are stored left-aligned: their limbs fill the top of the slot, the low limbs are zero.
+// Errors are kept as mpfr_get_d_2exp pairs (mant in [0.5, 1), or 0) so tiny values do not underflow.
+struct BinFileHeader {
+    char magic[8];              // "SQRTBIN1"
+    uint32_t header_size;       // sizeof(BinFileHeader)
+    uint32_t record_size;       // sizeof(BinRecordHeader) + limbs_per_record * limb_bytes
+    uint32_t limb_bytes;        // sizeof(mp_limb_t)
+    uint32_t limbs_per_record;
+    int64_t target_prec_bits;
+    uint64_t count;             // number of records (patched when the writer closes)
+    uint32_t byte_order;        // 0x01020304 as written by the producer
+    uint32_t reserved[5];
+};
+static_assert(sizeof(BinFileHeader) == 64, "BinFileHeader layout");
+
+struct BinRecordHeader {
+    int32_t iteration;
+    int32_t sign;               // -1, 0 (zero or nan), +1
+    uint32_t flags;             // BIN_NAN | BIN_INF | BIN_NO_ERRORS
+    uint32_t reserved;
+    int64_t prec_bits;
+    int64_t exponent;
+    double abs_err_mant;
+    int64_t abs_err_exp;
+    double rel_err_mant;
+    int64_t rel_err_exp;
+};
+static_assert(sizeof(BinRecordHeader) == 64, "BinRecordHeader layout");
+
+constexpr uint32_t BIN_NAN = 1, BIN_INF = 2, BIN_NO_ERRORS = 4;
+
+size_t limbs_for_prec(mpfr_prec_t prec) {
+    return static_cast<size_t>((prec + mp_bits_per_limb - 1) / mp_bits_per_limb);
+}
+
+// Fills the value fields of r (sign, flags, prec_bits, exponent) and copies the significand into
+// slot[0..slot_limbs), left-aligned when it is shorter than the slot (the low limbs become zero)
+void pack_bin_value(const mpreal& val, BinRecordHeader& r, mp_limb_t* slot, size_t slot_limbs) {
+    mpfr_srcptr x = val.mpfr_srcptr();
+    r.prec_bits = mpfr_get_prec(x);
+    std::fill(slot, slot + slot_limbs, mp_limb_t(0));
+    if (mpfr_nan_p(x)) { r.flags |= BIN_NAN; return; }
+    r.sign = mpfr_zero_p(x) ? 0 : (mpfr_signbit(x) ? -1 : 1);
+    if (mpfr_inf_p(x)) { r.flags |= BIN_INF; return; }
+    if (r.sign == 0) return;
+    r.exponent = mpfr_get_exp(x);
+    size_t n = limbs_for_prec(r.prec_bits);
+    const mp_limb_t* limbs = static_cast<const mp_limb_t*>(mpfr_custom_get_significand(x));
+    size_t keep = std::min(n, slot_limbs); // top limbs only, should a value exceed the slot
+    std::memcpy(slot + (slot_limbs - keep), limbs + (n - keep), keep * sizeof(mp_limb_t));
+}
+
+// Why a record read back from disk cannot be handed to MPFR, or nullptr when it can: known flags and
+// sign, a precision MPFR accepts whose ceil(prec / limb bits) limbs fit the record's slot, and for a
+// regular value an exponent inside [emin, emax] and a normalized significand with no bits set below
+// the precision (pack_bin_value never writes those, so a file that has them is corrupt)
+const char* bin_value_problem(const BinRecordHeader& r, const mp_limb_t* slot, size_t slot_limbs) {
+    if (r.flags & ~(BIN_NAN | BIN_INF | BIN_NO_ERRORS)) return "unknown record flags";
+    if (r.sign < -1 || r.sign > 1) return "bad sign";
+    if (r.prec_bits < MPFR_PREC_MIN || r.prec_bits > MPFR_PREC_MAX) return "precision out of range";
+    size_t n = limbs_for_prec(static_cast<mpfr_prec_t>(r.prec_bits));
+    if (n == 0 || n > slot_limbs) return "precision does not match the stored limbs";
+    if ((r.flags & (BIN_NAN | BIN_INF)) || r.sign == 0) return nullptr;
+    if (r.exponent < mpfr_get_emin() || r.exponent > mpfr_get_emax()) return "exponent out of range";
+    const mp_limb_t* m = slot + (slot_limbs - n);
+    if (!(m[n - 1] >> (GMP_NUMB_BITS - 1))) return "significand not normalized";
+    unsigned low = static_cast<unsigned>(n * GMP_NUMB_BITS - static_cast<size_t>(r.prec_bits));
+    if (low && (m[0] & ((mp_limb_t(1) << low) - 1))) return "significand bits below the precision";
+    return nullptr;
+}
+
+// Inverse of pack_bin_value: rounds the stored value into out (at out's precision)
+void unpack_bin_value(const BinRecordHeader& r, const mp_limb_t* slot, size_t slot_limbs, mpreal& out) {
+    int kind = MPFR_REGULAR_KIND;
+    if (r.flags & BIN_NAN) kind = MPFR_NAN_KIND;
+    else if (r.flags & BIN_INF) kind = MPFR_INF_KIND;
+    else if (r.sign == 0) kind = MPFR_ZERO_KIND;
+    mpfr_prec_t prec = std::min<mpfr_prec_t>(r.prec_bits, static_cast<mpfr_prec_t>(slot_limbs) * mp_bits_per_limb);
+    // a read-only view over the stored limbs; mpfr_set never writes to its source
+    mpfr_t view;
+    mpfr_custom_init_set(view, (r.sign < 0 ? -1 : 1) * kind, r.exponent, prec,
+        const_cast<mp_limb_t*>(slot + (slot_limbs - limbs_for_prec(prec))));
+    mpfr_set(out.mpfr_ptr(), view, MPFR_RNDN);
+}
+
+// Streams iterations to the --save-bin format as they are produced (no decimal conversion at all)
+class IterationBinWriter {
+public:
+    IterationBinWriter(const std::string& file, mpfr_prec_t target_bits)
+        : ofs_(file, std::ios::binary) {
+        if (!ofs_) {
+            std::cerr << "Could not open file for writing: " << file << "\n";
+            return;
+        }
+        limbs_ = limbs_for_prec(target_bits);
+        std::memset(&header_, 0, sizeof(header_));
+        std::memcpy(header_.magic, "SQRTBIN1", 8);
+        header_.header_size = sizeof(BinFileHeader);
+        header_.record_size = static_cast<uint32_t>(sizeof(BinRecordHeader) + limbs_ * sizeof(mp_limb_t));
+        header_.limb_bytes = sizeof(mp_limb_t);
+        header_.limbs_per_record = static_cast<uint32_t>(limbs_);
+        header_.target_prec_bits = target_bits;
+        header_.byte_order = 0x01020304;
+        ofs_.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+        slot_.resize(limbs_);
+    }
+
+    ~IterationBinWriter() {
+        if (!ofs_) return;
+        ofs_.seekp(offsetof(BinFileHeader, count));
+        ofs_.write(reinterpret_cast<const char*>(&header_.count), sizeof(header_.count));
+    }
+
+    bool ok() const { return static_cast<bool>(ofs_); }
+
+    void write(int i, const mpreal& val, const IterateError* e) {
+        if (!ofs_) return;
+        BinRecordHeader r;
+        std::memset(&r, 0, sizeof(r));
+        r.iteration = i;
+        pack_bin_value(val, r, slot_.data(), limbs_);
+        if (e) {
+            long ex;
+            r.abs_err_mant = mpfr_get_d_2exp(&ex, e->abs_err.mpfr_srcptr(), MPFR_RNDN);
+            r.abs_err_exp = ex;
+            r.rel_err_mant = mpfr_get_d_2exp(&ex, e->rel_err.mpfr_srcptr(), MPFR_RNDN);
+            r.rel_err_exp = ex;
+        }
+        else {
+            r.flags |= BIN_NO_ERRORS;
+        }
+        ofs_.write(reinterpret_cast<const char*>(&r), sizeof(r));
+        ofs_.write(reinterpret_cast<const char*>(slot_.data()), static_cast<std::streamsize>(limbs_ * sizeof(mp_limb_t)));
+        ++header_.count;
+    }
+
+private:
+    std::ofstream ofs_;
+    BinFileHeader header_;
+    size_t limbs_ = 0;
+    std::vector<mp_limb_t> slot_;
+};
+
+// --resume-from: the last iterate of a --save-bin file (the final result of an earlier run), at the
+// precision it was computed with. Prints the reason and returns false when the file is unusable.
+bool read_last_bin_value(const std::string& file, mpreal& out) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in) {
+        std::cerr << "Could not open resume file: " << file << "\n";
+        return false;
+    }
+    BinFileHeader h;
+    in.read(reinterpret_cast<char*>(&h), sizeof(h));
+    if (!in || std::memcmp(h.magic, "SQRTBIN1", 8) != 0 || h.limb_bytes != sizeof(mp_limb_t) || h.byte_order != 0x01020304
+        || h.header_size != sizeof(BinFileHeader)
+        || h.record_size != sizeof(BinRecordHeader) + h.limbs_per_record * sizeof(mp_limb_t)) {
+        std::cerr << "Not a --save-bin file from this platform: " << file << "\n";
+        return false;
+    }
+    if (h.target_prec_bits < MPFR_PREC_MIN || h.target_prec_bits > MPFR_PREC_MAX
+        || h.limbs_per_record != limbs_for_prec(static_cast<mpfr_prec_t>(h.target_prec_bits))) {
+        std::cerr << "Corrupt resume file (record size does not match its precision): " << file << "\n";
+        return false;
+    }
+    uint64_t count = h.count;
+    if (count == 0) { // writer did not close; count whole records instead
+        in.seekg(0, std::ios::end);
+        count = (static_cast<uint64_t>(in.tellg()) - h.header_size) / h.record_size;
+    }
+    if (count == 0) {
+        std::cerr << "Resume file has no iterations: " << file << "\n";
+        return false;
+    }
+    BinRecordHeader r;
+    std::vector<mp_limb_t> slot(h.limbs_per_record);
+    in.clear();
+    in.seekg(static_cast<std::streamoff>(h.header_size + (count - 1) * h.record_size));
+    in.read(reinterpret_cast<char*>(&r), sizeof(r));
+    in.read(reinterpret_cast<char*>(slot.data()), static_cast<std::streamsize>(slot.size() * sizeof(mp_limb_t)));
+    if (!in) {
+        std::cerr << "Truncated resume file: " << file << "\n";
+        return false;
+    }
+    if (const char* problem = bin_value_problem(r, slot.data(), slot.size())) {
+        std::cerr << "Corrupt resume file (" << problem << "): " << file << "\n";
+        return false;
+    }
+    out.setPrecision(static_cast<mpfr_prec_t>(r.prec_bits));
+    unpack_bin_value(r, slot.data(), slot.size(), out);
+    return true;
+}
+
+// What the result cache reports
+struct CacheStats {
+    unsigned long hits = 0, misses = 0, entries = 0;
+    size_t bytes = 0;
+};
+
+// LRU cache of final results, keyed by everything that determines a result except the precision
+// (see cache_key); each key keeps the results computed at each precision. A lookup at `bits`
+// is served by an exact-precision result, or by rounding a higher-precision one that came from a
+// converged run (rounding a capped run would not match what the kernel gives at `bits`).
+// Values are stored packed as in --save-bin on the ordinary heap, never in a GMP arena scope, so
+// they outlive the batch item that produced them. Thread-safe; the memory budget is approximate.
+class ResultCache {
+public:
+    explicit ResultCache(size_t budget_bytes) : budget_(budget_bytes) {}
+
+    bool lookup(const std::string& key, mpfr_prec_t bits, mpreal& out, int& iterations_used) {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            auto& by_bits = it->second->second.by_bits;
+            auto hit = by_bits.find(bits);
+            if (hit == by_bits.end()) {
+                for (hit = by_bits.upper_bound(bits); hit != by_bits.end() && !hit->second.converged; ++hit) {}
+            }
+            if (hit != by_bits.end()) {
+                const Stored& st = hit->second;
+                unpack_bin_value(st.header, st.limbs.data(), st.limbs.size(), out);
+                iterations_used = st.header.iteration;
+                lru_.splice(lru_.begin(), lru_, it->second); // most recently used first
+                ++stats_.hits;
+                return true;
+            }
+        }
+        ++stats_.misses;
+        return false;
+    }
+
+    // Highest-precision result stored for key below bits (a seed for refining to bits), at its own
+    // precision; not counted as a hit or miss
+    bool best_below(const std::string& key, mpfr_prec_t bits, mpreal& out) {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto it = index_.find(key);
+        if (it == index_.end()) return false;
+        auto& by_bits = it->second->second.by_bits;
+        auto below = by_bits.lower_bound(bits);
+        if (below == by_bits.begin()) return false;
+        --below;
+        out.setPrecision(below->first);
+        unpack_bin_value(below->second.header, below->second.limbs.data(), below->second.limbs.size(), out);
+        return true;
+    }
+
+    void insert(const std::string& key, const mpreal& value, int iterations_used, bool converged) {
+        Stored st;
+        std::memset(&st.header, 0, sizeof(st.header));
+        st.header.iteration = iterations_used;
+        st.header.flags = BIN_NO_ERRORS;
+        st.limbs.resize(limbs_for_prec(value.getPrecision()));
+        pack_bin_value(value, st.header, st.limbs.data(), st.limbs.size());
+        st.converged = converged;
+        std::lock_guard<std::mutex> lock(mu_);
+        put(key, std::move(st));
+    }
+
+    CacheStats stats() const {
+        std::lock_guard<std::mutex> lock(mu_);
+        CacheStats s = stats_;
+        s.entries = 0;
+        for (const auto& e : lru_) s.entries += e.second.by_bits.size();
+        s.bytes = bytes_;
+        return s;
+    }
+
+    // On-disk form: "SQRTCAC1", uint32 limb_bytes, uint32 byte_order, then per stored result:
+    // uint32 key length, key bytes, uint32 converged, BinRecordHeader (iteration = iterations used),
+    // limbs_for_prec(prec_bits) limbs. Written least recently used first, so loading keeps the order.
+    bool load(const std::string& file) {
+        std::ifstream in(file, std::ios::binary);
+        if (!in) return true; // nothing persisted yet
+        char magic[8];
+        uint32_t limb_bytes = 0, byte_order = 0;
+        in.read(magic, 8);
+        in.read(reinterpret_cast<char*>(&limb_bytes), sizeof(limb_bytes));
+        in.read(reinterpret_cast<char*>(&byte_order), sizeof(byte_order));
+        if (!in || std::memcmp(magic, "SQRTCAC1", 8) != 0 || limb_bytes != sizeof(mp_limb_t) || byte_order != 0x01020304) {
+            std::cerr << "Ignoring unreadable cache file: " << file << "\n";
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mu_);
+        uint32_t key_len;
+        while (in.read(reinterpret_cast<char*>(&key_len), sizeof(key_len))) {
+            std::string key(key_len, '\0');
+            Stored st;
+            uint32_t converged = 0;
+            in.read(&key[0], key_len);
+            in.read(reinterpret_cast<char*>(&converged), sizeof(converged));
+            in.read(reinterpret_cast<char*>(&st.header), sizeof(st.header));
+            if (!in || st.header.prec_bits <= 0) break;
+            st.limbs.resize(limbs_for_prec(st.header.prec_bits));
+            in.read(reinterpret_cast<char*>(st.limbs.data()), static_cast<std::streamsize>(st.limbs.size() * sizeof(mp_limb_t)));
+            if (!in) break;
+            st.converged = converged != 0;
+            put(key, std::move(st));
+        }
+        return true;
+    }
+
+    bool save(const std::string& file) const {
+        std::ofstream out(file, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "Could not open file for writing: " << file << "\n";
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mu_);
+        uint32_t limb_bytes = sizeof(mp_limb_t), byte_order = 0x01020304;
+        out.write("SQRTCAC1", 8);
+        out.write(reinterpret_cast<const char*>(&limb_bytes), sizeof(limb_bytes));
+        out.write(reinterpret_cast<const char*>(&byte_order), sizeof(byte_order));
+        for (auto e = lru_.rbegin(); e != lru_.rend(); ++e) {
+            for (const auto& kv : e->second.by_bits) {
+                const Stored& st = kv.second;
+                uint32_t key_len = static_cast<uint32_t>(e->first.size()), converged = st.converged ? 1 : 0;
+                out.write(reinterpret_cast<const char*>(&key_len), sizeof(key_len));
+                out.write(e->first.data(), key_len);
+                out.write(reinterpret_cast<const char*>(&converged), sizeof(converged));
+                out.write(reinterpret_cast<const char*>(&st.header), sizeof(st.header));
+                out.write(reinterpret_cast<const char*>(st.limbs.data()), static_cast<std::streamsize>(st.limbs.size() * sizeof(mp_limb_t)));
+            }
+        }
+        return static_cast<bool>(out);
+    }
+
+private:
+    struct Stored {
+        BinRecordHeader header;
+        std::vector<mp_limb_t> limbs;
+        bool converged = false;
+    };
+    struct Entry {
+        std::map<mpfr_prec_t, Stored> by_bits;
+        size_t bytes = 0;
+    };
+    using Lru = std::list<std::pair<std::string, Entry>>;
+
+    // caller holds mu_
+    void put(const std::string& key, Stored st) {
+        size_t cost = sizeof(Stored) + st.limbs.size() * sizeof(mp_limb_t);
+        if (cost + key.size() > budget_) return; // would evict everything and still not fit
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            lru_.emplace_front(key, Entry());
+            it = index_.emplace(key, lru_.begin()).first;
+            bytes_ += key.size();
+            lru_.front().second.bytes = key.size();
+        }
+        else {
+            lru_.splice(lru_.begin(), lru_, it->second);
+        }
+        Entry& e = it->second->second;
+        mpfr_prec_t bits = static_cast<mpfr_prec_t>(st.header.prec_bits);
+        auto old = e.by_bits.find(bits);
+        if (old != e.by_bits.end()) {
+            size_t old_cost = sizeof(Stored) + old->second.limbs.size() * sizeof(mp_limb_t);
+            e.bytes -= old_cost;
+            bytes_ -= old_cost;
+        }
+        e.by_bits[bits] = std::move(st);
+        e.bytes += cost;
+        bytes_ += cost;
+        while (bytes_ > budget_ && lru_.size() > 1) {
+            bytes_ -= lru_.back().second.bytes;
+            index_.erase(lru_.back().first);
+            lru_.pop_back();
+        }
+    }
+
+    size_t budget_;
+    size_t bytes_ = 0;
+    Lru lru_;
+    std::unordered_map<std::string, Lru::iterator> index_;
+    CacheStats stats_;
+    mutable std::mutex mu_;
+};
+
+std::string format_cache_stats(const CacheStats& st) {
+    std::ostringstream os;
+    os << "Cache: " << st.hits << " hits, " << st.misses << " misses, " << st.entries << " entries, " << st.bytes << " bytes";
+    return os.str();
+}
+
+// Small CLI option parser (very simple)
+struct Options {
+    std::string number = "2";
+    std::string number_file = ""; // --number read from this file (huge decimal strings)
+    unsigned long root = 2; // N-th root of the number (heron / recip kernels generalised, see nth_root)
+    bool inverse = false; // recip: output a^(-1/N) (1/sqrt(a) for N = 2), the iteration's y (see root_inverse)
+    unsigned long prec_digits = 100; // decimal digits of precision
+    int iterations = 20;
+    std::string init_mode = "auto"; // auto | manual | reciprocal-seed
+    std::string init_value = ""; // used when init_mode==manual
+    std::string method = "heron"; // heron | recip | karp
+    std::string precision_schedule = "fixed"; // fixed | doubling
+    std::string save_csv = "";
+    std::string save_bin = ""; // binary, mmap-able iterate file (see BinFileHeader)
+    std::string resume_from = ""; // --save-bin file whose last iterate seeds this run
+    bool until_converged = false; // stop once |x_{n+1} - x_n| is negligible (iterations becomes a cap)
+    std::string tol = ""; // relative tolerance for until_converged (decimal string); empty -> 2 ulps
+    std::string batch = ""; // batch input file, "-" = stdin
+    unsigned threads = 1; // batch worker threads, 0 = one per hardware thread
+    bool quiet = false; // no per-iteration table (and no iterate history at all unless --save-csv)
+    bool no_reference = false; // skip the high-precision reference and every error column
+    unsigned long digits_out = 0; // digits printed per value (0 -> prec_digits; never more)
+    bool arena = false; // GMP allocations from a per-thread bump arena (reset per batch input)
+    bool bench = false; // repeated-timing sweep instead of a single run
+    std::string bench_digits = "100,1000,10000"; // precisions (decimal digits) swept by --bench
+    std::string bench_methods = "heron,recip,karp,mpfr"; // methods swept by --bench (mpfr = mpfr_sqrt baseline)
+    int bench_warmup = 3;
+    int bench_reps = 20;
+    std::string bench_out = ""; // empty -> stdout
+    std::string bench_format = "csv"; // csv | json
+    bool serve = false; // line-delimited JSON requests on stdin, one JSON response line each on stdout
+    std::string tier = "mpfr"; // mpfr | builtin | fixed | auto (opt-in shortcuts, see use_builtin_tier / use_fixed_tier)
+    std::string mode = "sqrt"; // sqrt | isqrt (floor(sqrt(n)) and remainder of an integer, via mpz_sqrtrem)
+    bool int_path = true; // perfect-square integer inputs are answered exactly, without the kernels
+    unsigned long cache_mb = 0; // result cache budget for --batch / --serve (0 -> off, or 64 with --cache-file)
+    std::string cache_file = ""; // cache persisted here between runs
+    unsigned long mem_limit_mb = 0; // single-run memory budget: drops optional values, chunked output (0 -> off)
+    std::string spill_dir = ""; // large GMP blocks on mmap'd temporary files in this directory
+    std::string verify = ""; // cheap: correct rounding checked by one residual (verify_rounding), no reference / builtin
+    bool large = false; // multi-million-digit mode: karp, doubling schedule, residual-form rsqrt steps
+    bool stats = false; // single run: JSON block with peak RSS, GMP allocation counts and a per-phase breakdown
+    std::string stats_out = ""; // write the --stats block to this file instead of stdout (implies --stats)
+    std::string trace = ""; // single run: Chrome trace JSON of phases, kernel steps and decimal conversion
+    bool show_help = false;
+};
+
+// --large wins over --method / --precision-schedule, from the command line and in serve requests
+void apply_large(Options& opt) {
+    if (!opt.large) return;
+    opt.method = "karp";
+    opt.precision_schedule = "doubling";
+}
+
+Options parse_args(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--help" || a == "-h") { opt.show_help = true; break; }
+        if (a == "--number" && i + 1 < argc) opt.number = argv[++i];
+        else if (a == "--number-file" && i + 1 < argc) opt.number_file = argv[++i];
+        else if (a == "--root" && i + 1 < argc) opt.root = std::stoul(argv[++i]);
+        else if (a == "--inverse") opt.inverse = true;
+        else if (a == "--prec-digits" && i + 1 < argc) opt.prec_digits = static_cast<unsigned long>(std::stoul(argv[++i]));
+        else if (a == "--iterations" && i + 1 < argc) opt.iterations = std::stoi(argv[++i]);
+        else if (a == "--init-mode" && i + 1 < argc) opt.init_mode = argv[++i];
+        else if (a == "--init-value" && i + 1 < argc) opt.init_value = argv[++i];
+        else if (a == "--method" && i + 1 < argc) opt.method = argv[++i];
+        else if (a == "--precision-schedule" && i + 1 < argc) opt.precision_schedule = argv[++i];
+        else if (a == "--save-csv" && i + 1 < argc) opt.save_csv = argv[++i];
+        else if (a == "--save-bin" && i + 1 < argc) opt.save_bin = argv[++i];
+        else if (a == "--resume-from" && i + 1 < argc) opt.resume_from = argv[++i];
+        else if (a == "--batch" && i + 1 < argc) opt.batch = argv[++i];
+        else if (a == "--threads" && i + 1 < argc) opt.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        else if (a == "--quiet" || a == "-q") opt.quiet = true;
+        else if (a == "--no-reference") opt.no_reference = true;
+        else if (a == "--digits-out" && i + 1 < argc) opt.digits_out = std::stoul(argv[++i]);
+        else if (a == "--arena") opt.arena = true;
+        else if (a == "--bench") opt.bench = true;
+        else if (a == "--serve") opt.serve = true;
+        else if (a == "--mode" && i + 1 < argc) opt.mode = argv[++i];
+        else if (a == "--tier" && i + 1 < argc) opt.tier = argv[++i];
+        else if (a == "--large") opt.large = true;
+        else if (a == "--verify" && i + 1 < argc) opt.verify = argv[++i];
+        else if (a == "--mem-limit" && i + 1 < argc) opt.mem_limit_mb = std::stoul(argv[++i]);
+        else if (a == "--spill-dir" && i + 1 < argc) opt.spill_dir = argv[++i];
+        else if (a == "--stats") opt.stats = true;
+        else if (a == "--trace" && i + 1 < argc) opt.trace = argv[++i];
+        else if (a == "--stats-out" && i + 1 < argc) { opt.stats_out = argv[++i]; opt.stats = true; }
+        else if (a == "--no-int-path") opt.int_path = false;
+        else if (a == "--cache-mb" && i + 1 < argc) opt.cache_mb = std::stoul(argv[++i]);
+        else if (a == "--cache-file" && i + 1 < argc) opt.cache_file = argv[++i];
+        else if (a == "--bench-digits" && i + 1 < argc) opt.bench_digits = argv[++i];
+        else if (a == "--bench-methods" && i + 1 < argc) opt.bench_methods = argv[++i];
+        else if (a == "--warmup" && i + 1 < argc) opt.bench_warmup = std::stoi(argv[++i]);
+        else if (a == "--reps" && i + 1 < argc) opt.bench_reps = std::stoi(argv[++i]);
+        else if (a == "--bench-out" && i + 1 < argc) opt.bench_out = argv[++i];
+        else if (a == "--bench-format" && i + 1 < argc) opt.bench_format = argv[++i];
+        else if (a == "--until-converged") opt.until_converged = true;
+        else if (a == "--tol" && i + 1 < argc) { opt.tol = argv[++i]; opt.until_converged = true; }
+        else {
+            std::cerr << "Unknown or incomplete argument: " << a << "\n";
+            opt.show_help = true;
+            break;
+        }
+    }
+    apply_large(opt);
+    return opt;
+}
+
+void print_help() {
+    std::cout << "mpreal_sqrt_newton - high-precision sqrt via Newton/Herson and reciprocal-sqrt\n\n";
+    std::cout << "Usage:\n  ./mpreal_sqrt_newton [options]\n\n";
+    std::cout << "Options:\n";
+    std::cout << "  --number <value>        Number to compute sqrt of (decimal string). Default: 2\n";
+    std::cout << "  --number-file <file>    read the decimal string from file instead (million-digit inputs)\n";
+    std::cout << "  --root <n>              compute the n-th root instead (n >= 2; heron or recip). default: 2\n";
+    std::cout << "  --inverse               with --method recip: output a^(-1/n) (1/sqrt(a) by default)\n";
+    std::cout << "  --prec-digits <n>       Decimal digits of precision (default 100)\n";
+    std::cout << "  --iterations <n>        Number of Newton iterations to run (default 20)\n";
+    std::cout << "  --init-mode <mode>      initial guess mode: auto | manual (default auto)\n";
+    std::cout << "  --init-value <val>      initial guess value if init-mode==manual (decimal string)\n";
+    std::cout << "  --method <heron|recip|karp>\n";
+    std::cout << "                          heron (Newton), recip (reciprocal-sqrt) or karp (rsqrt to half\n";
+    std::cout << "                          precision + one Karp-Markstein step, no division). default: heron\n";
+    std::cout << "  --tier <mpfr|builtin|fixed|auto>\n";
+    std::cout << "                          mpfr (default): always the --method kernel. Opt-in shortcuts for\n";
+    std::cout << "                          runs with no per-iteration output (--batch, --serve, --quiet):\n";
+    std::cout << "                          builtin: mpfr_sqrt up to 96 bits; fixed: fixed-limb heron/recip\n";
+    std::cout << "                          up to 1024 bits; auto: both. Their results are correctly rounded,\n";
+    std::cout << "                          so they can differ from the kernel in the last bit\n";
+    std::cout << "  --precision-schedule <fixed|doubling>\n";
+    std::cout << "                          fixed: every iteration at full precision (default)\n";
+    std::cout << "                          doubling: start at 53 bits and ~double the precision each step\n";
+    std::cout << "  --large                 multi-million-digit mode: karp + doubling schedule, rsqrt steps\n";
+    std::cout << "                          in residual form (one product per step at half precision)\n";
+    std::cout << "  --verify cheap          make the result correctly rounded from one residual a - x^2 (moving\n";
+    std::cout << "                          it by an ulp if needed); skips the reference and builtin sqrt\n";
+    std::cout << "  --save-csv <file>       save iteration table to CSV file (written while iterating)\n";
+    std::cout << "  --save-bin <file>       save iterations as raw limbs in a fixed-record binary file\n";
+    std::cout << "                          that can be read through mmap without parsing (see README)\n";
+    std::cout << "  --resume-from <file>    seed with the last iterate of a --save-bin file from an earlier\n";
+    std::cout << "                          (lower-precision) run; implies the doubling schedule, started\n";
+    std::cout << "                          at its correct bits, and --until-converged\n";
+    std::cout << "  --quiet, -q             do not print the per-iteration table\n";
+    std::cout << "  --no-reference          skip the high-precision reference (no error columns or lines)\n";
+    std::cout << "  --digits-out <n>        print n digits per value instead of --prec-digits (computation\n";
+    std::cout << "                          still runs at --prec-digits; applies to table, CSV and batch)\n";
+    std::cout << "  --until-converged       stop when |x_{n+1} - x_n| is within 2 ulps; --iterations becomes a cap\n";
+    std::cout << "  --tol <value>           like --until-converged, stopping when |x_{n+1} - x_n| <= tol * |x_{n+1}|\n";
+    std::cout << "  --batch <file|->        read one number per line (\"-\" = stdin) and print one line per input:\n";
+    std::cout << "                          <input> <sqrt> <iterations used> <kernel ns> (no reference/table)\n";
+    std::cout << "  --threads <n>           batch worker threads (work-stealing, output stays in input order);\n";
+    std::cout << "                          0 = one per hardware thread. default: 1\n";
+    std::cout << "                          single run: threads for the large kernel products and heron\n";
+    std::cout << "                          divides, with the reference and builtin sqrt on helper threads\n";
+    std::cout << "                          alongside\n";
+    std::cout << "  --mem-limit <MiB>       single-run memory budget: drop the reference / builtin sqrt when they\n";
+    std::cout << "                          do not fit next to the kernel, free values early, write digits in chunks\n";
+    std::cout << "  --spill-dir <dir>       map GMP blocks of 16 MiB and more from temporary files in dir\n";
+    std::cout << "  --stats                 single run: print a JSON block with peak RSS, GMP allocation counts\n";
+    std::cout << "                          and bytes, and time / allocations per phase (parse ... output)\n";
+    std::cout << "  --stats-out <file>      write the --stats block to file instead of stdout\n";
+    std::cout << "  --trace <file>          single run: write a Chrome trace (Perfetto, chrome://tracing) of the\n";
+    std::cout << "                          phases, each kernel step, decimal conversion and parallel products\n";
+    std::cout << "  --arena                 serve GMP/MPFR allocations from a per-thread bump arena, reset after\n";
+    std::cout << "                          each batch input; prints allocation stats in the summary\n";
+    std::cout << "  --bench                 time the kernels repeatedly over a precision x method sweep and\n";
+    std::cout << "                          report min/median/p95/MAD (uses --number, schedule, stop options)\n";
+    std::cout << "  --bench-digits <list>   comma-separated precisions for --bench (default 100,1000,10000)\n";
+    std::cout << "  --bench-methods <list>  comma-separated heron,recip,karp,mpfr,pow,\n";
+    std::cout << "                          heron-fixed,recip-fixed (default: heron,recip,karp,mpfr);\n";
+    std::cout << "                          with --root n: heron, recip, mpfr (mpfr_rootn_ui) and pow (a^(1/n))\n";
+    std::cout << "  --warmup <n>            untimed runs per bench cell (default 3)\n";
+    std::cout << "  --reps <n>              timed runs per bench cell (default 20)\n";
+    std::cout << "  --bench-out <file>      write bench results to file instead of stdout\n";
+    std::cout << "  --bench-format <csv|json>  bench output format (default csv)\n";
+    std::cout << "  --serve                 long-lived worker: one JSON request per stdin line, one JSON\n";
+    std::cout << "                          response per stdout line (same shape as app.py /api/sqrt)\n";
+    std::cout << "  --mode <sqrt|isqrt>     isqrt: exact floor(sqrt(n)) and remainder n - s^2 of an integer n\n";
+    std::cout << "                          (mpz_sqrtrem; also in --batch and --serve)\n";
+    std::cout << "  --no-int-path           run the kernels even for perfect-square integer inputs\n";
+    std::cout << "  --cache-mb <n>          LRU result cache of n MiB for --batch and --serve; hits skip the\n";
+    std::cout << "                          kernel, and converged results also answer lower precisions\n";
+    std::cout << "  --cache-file <file>     load the cache from file at start and save it at exit\n";
+    std::cout << "                          (enables a 64 MiB cache unless --cache-mb is given)\n";
+    std::cout << "  --help, -h              show this help\n";
+}
+
+// Method and schedule names; prints the reason and returns false when one is unknown
+bool check_method_options(const Options& opt) {
+    if (opt.mode != "sqrt" && opt.mode != "isqrt") {
+        std::cerr << "Unknown mode: " << opt.mode << "\n";
+        return false;
+    }
+    if (opt.tier != "mpfr" && opt.tier != "builtin" && opt.tier != "fixed" && opt.tier != "auto") {
+        std::cerr << "Unknown tier: " << opt.tier << "\n";
+        return false;
+    }
+    if (opt.precision_schedule != "fixed" && opt.precision_schedule != "doubling") {
+        std::cerr << "Unknown precision schedule: " << opt.precision_schedule << "\n";
+        return false;
+    }
+    if (opt.method != "heron" && opt.method != "recip" && opt.method != "karp") {
+        std::cerr << "Unknown method: " << opt.method << "\n";
+        return false;
+    }
+    if (!opt.verify.empty() && opt.verify != "cheap") {
+        std::cerr << "Unknown verify mode: " << opt.verify << "\n";
+        return false;
+    }
+    if (opt.root < 2) {
+        std::cerr << "--root needs n >= 2\n";
+        return false;
+    }
+    if (opt.root != 2) {
+        const char* unsupported = opt.mode != "sqrt" ? "--mode isqrt"
+            : opt.method != "heron" && opt.method != "recip" ? "--method karp"
+            : !opt.verify.empty() ? "--verify"
+            : !opt.resume_from.empty() ? "--resume-from" : nullptr;
+        if (unsupported) {
+            std::cerr << "--root " << opt.root << " cannot be combined with " << unsupported << " (square roots only)\n";
+            return false;
+        }
+    }
+    if (opt.inverse) {
+        const char* unsupported = opt.method != "recip" ? "--method heron / karp (the output is the recip iterate)"
+            : opt.mode != "sqrt" ? "--mode isqrt"
+            : !opt.verify.empty() ? "--verify"
+            : !opt.resume_from.empty() ? "--resume-from" : nullptr;
+        if (unsupported) {
+            std::cerr << "--inverse cannot be combined with " << unsupported << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// --tier builtin / auto: a run up to BUILTIN_TIER_MAX_BITS whose iterates nobody sees only needs the
+// final value, and at these sizes mpfr_sqrt (correctly rounded, ~27 ns at 96 bits) beats every kernel.
+// Opt-in, like the fixed tier: the kernels are not correctly rounded, so switching by default would
+// make the printed value depend on --quiet and the output files. This is a pass-through to mpfr_sqrt,
+// not a double-double / quad-double kernel: the earlier DD kernel was slower than mpfr_sqrt here.
+constexpr mpfr_prec_t BUILTIN_TIER_MAX_BITS = 96;
+
+bool use_builtin_tier(const Options& opt, mpfr_prec_t bits, bool iterates_wanted) {
+    return opt.root == 2 && !opt.inverse && (opt.tier == "builtin" || opt.tier == "auto") && opt.mode == "sqrt" && bits <= BUILTIN_TIER_MAX_BITS && !iterates_wanted && opt.resume_from.empty();
+}
+
+// --tier fixed (auto: above BUILTIN_TIER_MAX_BITS): heron / recip up to FIXED_MAX_BITS use the
+// fixed-limb kernels when only the final value is wanted and the requested iterations (and an automatic
+// seed) would get that far anyway; the fixed kernels run their own compile-time count
+bool use_fixed_tier(const Options& opt, mpfr_prec_t bits, bool iterates_wanted) {
+    mpfr_prec_t size = fixed_size_bits(bits);
+    return (opt.tier == "fixed" || opt.tier == "auto") && opt.mode == "sqrt" && opt.root == 2 && !opt.inverse && (opt.method == "heron" || opt.method == "recip") && size != 0
+        && !iterates_wanted && opt.resume_from.empty() && opt.init_mode != "manual" && opt.iterations >= fixed_iterations(size);
+}
+
+constexpr mpfr_prec_t REFERENCE_EXTRA_BITS = 64; // the reference runs at bits + this
+
+// Precision parse_number_odd needs so that the kernel input and the reference input both derive from it
+inline mpfr_prec_t input_parse_prec(mpfr_prec_t bits) {
+    return bits + REFERENCE_EXTRA_BITS + 2;
+}
+
+// One decimal -> binary conversion for every precision a run needs: the string is truncated to prec
+// bits and the last bit is set when anything was dropped (round to odd). mpfr_set to nearest at
+// prec - 2 bits or fewer then gives exactly the correctly rounded value of the string, so the kernel
+// input, the reference input and the double for std::sqrt are roundings of this value, not re-parses.
+bool parse_number_odd(const std::string& number, mpfr_prec_t prec, mpreal& out) {
+    mpfr_set_prec(out.mpfr_ptr(), prec);
+    const char* s = number.c_str();
+    char* end = nullptr;
+    int inexact = mpfr_strtofr(out.mpfr_ptr(), s, &end, 10, MPFR_RNDZ);
+    if (end == s || *end != '\0') return false;
+    if (inexact && mpfr_number_p(out.mpfr_srcptr()) && !mpfr_zero_p(out.mpfr_srcptr()) && mpfr_min_prec(out.mpfr_srcptr()) < prec) {
+        if (mpfr_signbit(out.mpfr_srcptr())) mpfr_nextbelow(out.mpfr_ptr()); // one ulp away from zero: sets the last bit
+        else mpfr_nextabove(out.mpfr_ptr());
+    }
+    return true;
+}
+
+// --number-file: the decimal string of a file, surrounding whitespace removed
+bool read_number_file(const std::string& file, std::string& number) {
+    std::ifstream f(file, std::ios::binary | std::ios::ate);
+    if (!f) {
+        std::cerr << "Cannot open number file: " << file << "\n";
+        return false;
+    }
+    number.resize(static_cast<size_t>(f.tellg()));
+    f.seekg(0);
+    f.read(&number[0], static_cast<std::streamsize>(number.size()));
+    if (!f) {
+        std::cerr << "Cannot read number file: " << file << "\n";
+        return false;
+    }
+    size_t b = 0, e = number.size();
+    while (b < e && std::isspace(static_cast<unsigned char>(number[b]))) ++b;
+    while (e > b && std::isspace(static_cast<unsigned char>(number[e - 1]))) --e;
+    number.erase(e);
+    number.erase(0, b);
+    return true;
+}
+
+// "Input:" line: the string itself, or the file and its length for --number-file
+std::string input_label(const Options& opt) {
+    if (opt.number_file.empty()) return opt.number;
+    return opt.number_file + " (" + std::to_string(opt.number.size()) + " characters)";
+}
+
+// MPFR's own root: mpfr_sqrt, or mpfr_rootn_ui for --root N. inverse (--inverse): mpfr_rec_sqrt, or
+// 1 / mpfr_rootn_ui (rounded twice; MPFR has no inverse N-th root)
+inline void builtin_root(mpfr_ptr r, mpfr_srcptr a, unsigned long root, bool inverse = false) {
+    if (root == 2) {
+        if (inverse) mpfr_rec_sqrt(r, a, MPFR_RNDN);
+        else mpfr_sqrt(r, a, MPFR_RNDN);
+        return;
+    }
+    mpfr_rootn_ui(r, a, root, MPFR_RNDN);
+    if (inverse) mpfr_ui_div(r, 1, r, MPFR_RNDN);
+}
+
+// High-precision reference: sqrt of the input at bits + 64, rounded once to the precision of
+// reference by mpfr_set (it rounds to the destination's precision, no decimal round-trip).
+// a_in is the parse_number_odd value at input_parse_prec(bits).
+void build_reference(mpfr_srcptr a_in, mpfr_prec_t bits, mpreal& reference, unsigned long root = 2, bool inverse = false) {
+    mpreal a_high(0, bits + REFERENCE_EXTRA_BITS);
+    mpfr_set(a_high.mpfr_ptr(), a_in, MPFR_RNDN);
+    builtin_root(a_high.mpfr_ptr(), a_high.mpfr_srcptr(), root, inverse);
+    mpfr_set(reference.mpfr_ptr(), a_high.mpfr_srcptr(), MPFR_RNDN);
+}
+
+// --verify cheap: x = RN(sqrt(a)) exactly when sqrt(a) lies between the midpoints lo and hi that x
+// shares with its neighbours. One exact residual r = a - x^2 decides both sides, since
+// a - lo^2 = r + d(2x - d) and a - hi^2 = r - d'(2x + d') with the half-gaps d, d' powers of two
+// (d is a quarter ulp when x is a power of two). sqrt(a) is never a midpoint, so the signs are strict.
+// A wrong side moves x one ulp and repeats; beyond VERIFY_MAX_ULPS the kernel result is replaced by
+// mpfr_sqrt.
+constexpr int VERIFY_MAX_ULPS = 4;
+
+struct VerifyResult {
+    int ulps = 0; // ulps x was moved by (negative: down)
+    bool fallback = false; // too far off (or not a positive regular value): mpfr_sqrt was used
+};
+
+VerifyResult verify_rounding(mpfr_srcptr a, mpreal& x) {
+    VerifyResult res;
+    mpfr_ptr xp = x.mpfr_ptr();
+    mpfr_prec_t p = mpfr_get_prec(xp);
+    if (mpfr_regular_p(a) && mpfr_sgn(a) > 0) {
+        mpfr_prec_t wide = 2 * std::max(p, mpfr_get_prec(a)) + 8; // every step below is exact
+        mpreal r(0, wide), side(0, wide), t(0, wide), d(0, 2);
+        for (int k = 0; k <= VERIFY_MAX_ULPS && mpfr_regular_p(xp) && mpfr_sgn(xp) > 0; ++k) {
+            mpfr_exp_t ulp_exp = mpfr_get_exp(xp) - p;
+            bool exact = mpfr_sqr(r.mpfr_ptr(), xp, MPFR_RNDN) == 0;
+            exact = mpfr_sub(r.mpfr_ptr(), a, r.mpfr_srcptr(), MPFR_RNDN) == 0 && exact; // r = a - x^2
+            // below: d = half the gap to the next value down
+            mpfr_set_ui_2exp(d.mpfr_ptr(), 1, ulp_exp - (mpfr_min_prec(xp) == 1 ? 2 : 1), MPFR_RNDN);
+            mpfr_mul_2ui(t.mpfr_ptr(), xp, 1, MPFR_RNDN);
+            exact = mpfr_sub(t.mpfr_ptr(), t.mpfr_srcptr(), d.mpfr_srcptr(), MPFR_RNDN) == 0 && exact;
+            mpfr_mul(t.mpfr_ptr(), t.mpfr_srcptr(), d.mpfr_srcptr(), MPFR_RNDN);
+            exact = mpfr_add(side.mpfr_ptr(), r.mpfr_srcptr(), t.mpfr_srcptr(), MPFR_RNDN) == 0 && exact; // a - lo^2
+            if (!exact) break;
+            if (mpfr_sgn(side.mpfr_srcptr()) < 0) {
+                mpfr_nextbelow(xp);
+                --res.ulps;
+                continue;
+            }
+            // above: d' = half an ulp
+            mpfr_set_ui_2exp(d.mpfr_ptr(), 1, ulp_exp - 1, MPFR_RNDN);
+            mpfr_mul_2ui(t.mpfr_ptr(), xp, 1, MPFR_RNDN);
+            exact = mpfr_add(t.mpfr_ptr(), t.mpfr_srcptr(), d.mpfr_srcptr(), MPFR_RNDN) == 0;
+            mpfr_mul(t.mpfr_ptr(), t.mpfr_srcptr(), d.mpfr_srcptr(), MPFR_RNDN);
+            exact = mpfr_sub(side.mpfr_ptr(), r.mpfr_srcptr(), t.mpfr_srcptr(), MPFR_RNDN) == 0 && exact; // a - hi^2
+            if (!exact) break;
+            if (mpfr_sgn(side.mpfr_srcptr()) > 0) {
+                mpfr_nextabove(xp);
+                ++res.ulps;
+                continue;
+            }
+            return res;
+        }
+    }
+    else if (mpfr_zero_p(a) && mpfr_zero_p(xp)) {
+        return res;
+    }
+    res.fallback = true;
+    mpfr_sqrt(xp, a, MPFR_RNDN);
+    return res;
+}
+
+std::string format_verify(const VerifyResult& v) {
+    if (v.fallback) return "kernel result more than " + std::to_string(VERIFY_MAX_ULPS) + " ulps off, replaced by mpfr_sqrt";
+    if (v.ulps == 0) return "correctly rounded";
+    return std::string("adjusted by ") + (v.ulps > 0 ? "+" : "") + std::to_string(v.ulps) + " ulp to the correctly rounded value";
+}
+
+// --mem-limit: which optional values of a single run fit next to the kernel. Every count is in
+// full-precision values and includes the GMP temporaries of the products that build it.
+constexpr size_t MEM_KERNEL_VALUES = 10;   // a, kernel scratch (5), result, multiply/divide temporaries
+constexpr size_t MEM_REFERENCE_VALUES = 3; // the parsed input, its sqrt temporaries, the reference
+constexpr size_t MEM_BUILTIN_VALUES = 2;   // mpfr_sqrt result and temporaries
+
+struct MemoryPlan {
+    size_t value_bytes = 0;
+    size_t kernel_bytes = 0;
+    bool reference = true;
+    bool builtin = true;
+    bool chunked_output = false; // write_decimal_chunked instead of DecimalFormatter
+};
+
+MemoryPlan plan_memory(const Options& opt, mpfr_prec_t bits) {
+    MemoryPlan mp;
+    if (opt.mem_limit_mb == 0) return mp;
+    mp.value_bytes = mpfr_custom_get_size(bits);
+    mp.kernel_bytes = MEM_KERNEL_VALUES * mp.value_bytes;
+    mp.chunked_output = true;
+    size_t budget = static_cast<size_t>(opt.mem_limit_mb) << 20;
+    size_t left = budget > mp.kernel_bytes ? budget - mp.kernel_bytes : 0;
+    auto fits = [&](size_t values) {
+        if (values * mp.value_bytes > left) return false;
+        left -= values * mp.value_bytes;
+        return true;
+    };
+    mp.reference = !opt.no_reference && fits(MEM_REFERENCE_VALUES);
+    mp.builtin = fits(MEM_BUILTIN_VALUES);
+    std::cerr << "Memory plan: " << (mp.value_bytes >> 20) << " MiB per value, kernel ~" << (mp.kernel_bytes >> 20)
+        << " MiB of " << opt.mem_limit_mb << " MiB";
+    if (!opt.no_reference && !mp.reference) std::cerr << "; reference dropped";
+    if (!mp.builtin) std::cerr << "; builtin sqrt dropped";
+    std::cerr << "\n";
+    if (mp.kernel_bytes > budget) {
+        std::cerr << "The kernel alone needs more than --mem-limit"
+            << (opt.spill_dir.empty() ? "; --spill-dir lets its blocks live on disk\n" : "; its large blocks are spilled\n");
+    }
+    return mp;
+}
+
+// The result cache requested by --cache-mb / --cache-file (null when off), loaded from --cache-file
+std::unique_ptr<ResultCache> make_cache(const Options& opt) {
+    unsigned long mb = opt.cache_mb ? opt.cache_mb : (opt.cache_file.empty() ? 0 : 64);
+    if (mb == 0) return nullptr;
+    std::unique_ptr<ResultCache> cache(new ResultCache(static_cast<size_t>(mb) << 20));
+    if (!opt.cache_file.empty()) cache->load(opt.cache_file);
+    return cache;
+}
+
+// Reports the counters on stderr and persists the cache to --cache-file
+void finish_cache(const Options& opt, const ResultCache* cache) {
+    if (!cache) return;
+    if (!opt.cache_file.empty()) cache->save(opt.cache_file);
+    std::cerr << format_cache_stats(cache->stats()) << "\n";
+}
+
+// Everything a kernel run needs that depends only on the options, built once and reused across inputs
+struct KernelPlan {
+    mpfr_prec_t bits = 0;                // target precision
+    std::vector<mpfr_prec_t> precs;      // heron / recip schedule
+    std::vector<mpfr_prec_t> half_precs; // karp rsqrt-stage schedule
+    std::vector<mpfr_prec_t> root_precs; // --root N schedule, to bits + root_guard_bits(N)
+    StopRule stop;
+    bool fixed = false;                  // heron / recip through fixed_kernel (see use_fixed_tier)
+    bool builtin = false;                // mpfr_sqrt straight away (see use_builtin_tier)
+};
+
+bool make_plan(const Options& opt, mpfr_prec_t bits, KernelPlan& plan, mpfr_prec_t seed_bits = SEED_PREC_BITS) {
+    plan.bits = bits;
+    plan.fixed = false;
+    plan.builtin = false;
+    // Per-iteration working precision (all == bits unless --precision-schedule doubling)
+    plan.precs = build_precision_schedule(opt.precision_schedule, bits, opt.iterations, seed_bits);
+    // the karp rsqrt stage only needs half the bits; its final correction runs at full precision
+    plan.half_precs = build_precision_schedule(opt.precision_schedule, karp_half_prec(bits), opt.iterations, seed_bits);
+    if (opt.root != 2 || opt.inverse) plan.root_precs = build_precision_schedule(opt.precision_schedule, bits + root_guard_bits(opt.root), opt.iterations, seed_bits);
+    plan.stop.enabled = opt.until_converged;
+    if (!opt.tol.empty()) {
+        plan.stop.tol = mpreal(opt.tol, 64);
+        if (!(plan.stop.tol >= 0)) {
+            std::cerr << "Invalid --tol: " << opt.tol << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Result cache key: every option that changes the result of `number` except the precision, with
+// the tier the plan actually runs (so a tier or --verify switch never returns a stale value)
+std::string cache_key(const Options& opt, const KernelPlan& plan, const std::string& number) {
+    const char sep = '\x1f';
+    std::string key = number;
+    for (const std::string* part : { &opt.method, &opt.precision_schedule, &opt.init_mode, &opt.init_value, &opt.tol, &opt.verify }) {
+        key += sep;
+        key += *part;
+    }
+    key += sep + std::to_string(opt.iterations) + sep + (opt.until_converged ? "1" : "0") + sep + (opt.large ? "1" : "0");
+    key += sep;
+    key += plan.builtin ? "builtin" : plan.fixed ? "fixed" : "general";
+    if (opt.root != 2) key += sep + std::to_string(opt.root);
+    if (opt.inverse) key += std::string(1, sep) + "inverse";
+    return key;
+}
+
+// Initial guesses: x0 approximates sqrt(a), y0 approximates 1/sqrt(a) (only set for recip/karp);
+// a^(1/N) and a^(-1/N) with --root N.
+// Prints the reason and returns false when the seed options are unusable.
+bool prepare_seeds(const Options& opt, const mpreal& a, mpreal& x0, mpreal& y0) {
+    if (opt.init_mode == "manual") {
+        if (opt.init_value.empty()) {
+            std::cerr << "init-mode=manual but --init-value not provided\n";
+            return false;
+        }
+        x0 = mpreal(opt.init_value);
+    }
+    else if (opt.root != 2) {
+        x0 = auto_initial_root_guess(a, opt.root, false);
+    }
+    else {
+        // auto or other modes -> use automatic pre-seed
+        x0 = auto_initial_guess(a);
+    }
+
+    // if user chooses reciprocal method but provided init_mode manual as sqrt guess, convert to y0
+    if (opt.method == "recip" || opt.method == "karp") {
+        if (opt.init_mode == "manual") {
+            // interpret init_value as sqrt guess -> convert to reciprocal
+            if (x0 == 0) {
+                std::cerr << "Zero initial guess for reciprocal method invalid\n";
+                return false;
+            }
+            y0 = 1 / x0;
+        }
+        else {
+            // automatic reciprocal seed straight from the exponent/mantissa of a
+            if (a == 0) {
+                y0 = mpreal(1, SEED_PREC_BITS); // fallback
+            }
+            else {
+                y0 = opt.root == 2 ? auto_initial_rsqrt_guess(a) : auto_initial_root_guess(a, opt.root, true);
+            }
+        }
+    }
+    return true;
+}
+
+// Bits of x that agree with sqrt(a), from the relative residual |x^2 - a| / a ~ 2 |x - sqrt(a)| / sqrt(a)
+mpfr_prec_t seed_correct_bits(const mpreal& a, const mpreal& x) {
+    mpfr_prec_t px = x.getPrecision();
+    if (a == 0 || x <= 0) return 0;
+    mpreal sq(0, px + 64), res(0, 64);
+    mpfr_sqr(sq.mpfr_ptr(), x.mpfr_srcptr(), MPFR_RNDN);
+    mpfr_sub(res.mpfr_ptr(), sq.mpfr_srcptr(), a.mpfr_srcptr(), MPFR_RNDN);
+    mpfr_div(res.mpfr_ptr(), res.mpfr_srcptr(), a.mpfr_srcptr(), MPFR_RNDN);
+    if (mpfr_zero_p(res.mpfr_srcptr())) return px;
+    long correct = -static_cast<long>(mpfr_get_exp(res.mpfr_srcptr()));
+    return static_cast<mpfr_prec_t>(std::max(0L, std::min<long>(correct, px)));
+}
+
+// Replaces the seeds by an earlier result for the same input and restarts the plan's schedules at
+// its correct bits. A resumed run always takes the doubling schedule until converged: a fixed
+// schedule would run every step at full precision and redo the bits the seed already has.
+// A seed that does not match a (fewer correct bits than the automatic guess) is reported and
+// ignored; returns the seed's correct bits, or 0 when it was not used.
+mpfr_prec_t apply_resume_seed(const Options& opt, const mpreal& a, const mpreal& seed, mpfr_prec_t bits,
+                              KernelPlan& plan, mpreal& x0, mpreal& y0) {
+    mpfr_prec_t good = std::min(seed_correct_bits(a, seed), bits);
+    if (good < SEED_PREC_BITS) {
+        std::cerr << "Resume seed does not match the input (" << good << " correct bits); using the automatic guess\n";
+        return 0;
+    }
+    x0 = seed;
+    if (opt.method == "recip" || opt.method == "karp") {
+        y0 = mpreal(0, seed.getPrecision());
+        mpfr_ui_div(y0.mpfr_ptr(), 1, seed.mpfr_srcptr(), MPFR_RNDN);
+    }
+    Options resumed = opt;
+    resumed.precision_schedule = "doubling";
+    resumed.until_converged = true;
+    make_plan(resumed, bits, plan, good); // options were validated by the first make_plan
+    return good;
+}
+
+// One timed kernel run
+struct SqrtRun {
+    mpreal approx;
+    int iterations_used = 0;
+    long long elapsed_ns = 0; // kernel only: time spent inside the sink is subtracted
+};
+
+// Method dispatch shared by single-number and batch mode (opt.method is validated in main).
+// Without a sink no iterate outlives its step.
+SqrtRun run_method(const Options& opt, const KernelPlan& plan, const mpreal& a, const mpreal& x0, const mpreal& y0, const IterationSink& sink = nullptr, KernelScratch* scratch = nullptr) {
+    long long sink_ns = 0;
+    IterationSink timed_sink;
+    if (sink) {
+        timed_sink = [&](int i, const mpreal& v) {
+            auto t = time_in_ns([&]() { sink(i, v); return 0; });
+            sink_ns += t.second;
+            };
+    }
+    std::pair<KernelResult, long long> timed;
+    if (plan.builtin) { // reported as one iteration
+        timed = time_in_ns([&]() {
+            KernelResult r{ mpreal(0, plan.bits), 1 };
+            mpfr_sqrt(r.value.mpfr_ptr(), a.mpfr_srcptr(), MPFR_RNDN);
+            return r;
+            });
+    }
+    else if (plan.fixed) {
+        const mpreal& seed = opt.method == "heron" ? x0 : y0;
+        timed = time_in_ns([&]() { return fixed_kernel(opt.method == "heron", a, seed, plan.bits); });
+    }
+    else if (opt.inverse) {
+        timed = time_in_ns([&]() { return inverse_nth_root(opt.root, a, y0, opt.iterations, plan.root_precs, plan.stop, plan.bits, timed_sink, scratch); });
+    }
+    else if (opt.root != 2) {
+        bool inverse = opt.method == "recip";
+        timed = time_in_ns([&]() { return nth_root(opt.root, inverse, a, inverse ? y0 : x0, opt.iterations, plan.root_precs, plan.stop, plan.bits, timed_sink, scratch); });
+    }
+    else if (opt.method == "heron") {
+        timed = time_in_ns([&]() { return newton_heron(a, x0, opt.iterations, plan.precs, plan.stop, timed_sink, scratch); });
+    }
+    else if (opt.method == "recip") {
+        timed = time_in_ns([&]() { return reciprocal_sqrt(a, y0, opt.iterations, plan.precs, plan.stop, timed_sink, scratch); });
+    }
+    else {
+        timed = time_in_ns([&]() { return karp_sqrt(a, y0, opt.iterations, plan.half_precs, plan.stop, plan.bits, timed_sink, scratch, opt.large); });
+    }
+    SqrtRun run;
+    run.approx = std::move(timed.first.value);
+    run.iterations_used = timed.first.iterations_used;
+    run.elapsed_ns = timed.second - sink_ns;
+    return run;
+}
+
+// Fixed set of worker threads, each owning a deque of task indices. A worker pops from the back of
+// its own deque and, once empty, steals from the front of the others', so uneven task costs even out
+// without static chunking. run(n) spreads [0, n) over the deques in contiguous ranges and returns when
+// every task has finished; on_start runs once on each worker thread before its first task.
+class WorkStealingPool {
+public:
+    using Task = std::function<void(unsigned worker, size_t index)>;
+
+    WorkStealingPool(unsigned threads, std::function<void(unsigned)> on_start, Task task)
+        : queues_(std::max(1u, threads)), task_(std::move(task)) {
+        for (unsigned w = 0; w < queues_.size(); ++w) {
+            workers_.emplace_back([this, w, on_start]() {
+                if (on_start) on_start(w);
+                worker_loop(w);
+            });
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& t : workers_) t.join();
+    }
+
+    void run(size_t n) {
+        if (n == 0) return;
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            remaining_ = n; // set before any task is visible so late-waking workers count correctly
+        }
+        size_t per = (n + queues_.size() - 1) / queues_.size();
+        for (size_t w = 0; w < queues_.size(); ++w) {
+            std::lock_guard<std::mutex> lk(queues_[w].m);
+            for (size_t i = w * per; i < std::min(n, (w + 1) * per); ++i) queues_[w].tasks.push_back(i);
+        }
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            ++generation_;
+        }
+        wake_.notify_all();
+        std::unique_lock<std::mutex> lk(m_);
+        done_.wait(lk, [this]() { return remaining_ == 0; });
+    }
+
+private:
+    struct Queue {
+        std::mutex m;
+        std::deque<size_t> tasks;
+    };
+
+    bool pop_or_steal(unsigned w, size_t& index) {
+        {
+            std::lock_guard<std::mutex> lk(queues_[w].m);
+            if (!queues_[w].tasks.empty()) {
+                index = queues_[w].tasks.back();
+                queues_[w].tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t k = 1; k < queues_.size(); ++k) {
+            Queue& victim = queues_[(w + k) % queues_.size()];
+            std::lock_guard<std::mutex> lk(victim.m);
+            if (!victim.tasks.empty()) {
+                index = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void worker_loop(unsigned w) {
+        size_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lk(m_);
+                wake_.wait(lk, [&]() { return stop_ || generation_ != seen; });
+                if (stop_) return;
+                seen = generation_;
+            }
+            size_t index, finished = 0;
+            while (pop_or_steal(w, index)) {
+                task_(w, index);
+                ++finished;
+            }
+            if (finished) {
+                std::lock_guard<std::mutex> lk(m_);
+                remaining_ -= finished;
+                if (remaining_ == 0) done_.notify_all();
+            }
+        }
+    }
+
+    std::vector<Queue> queues_;
+    std::vector<std::thread> workers_;
+    Task task_;
+    std::mutex m_;
+    std::condition_variable wake_, done_;
+    size_t generation_ = 0, remaining_ = 0;
+    bool stop_ = false;
+};
+
+// --threads N in a single run: each large kernel product is cut into kx x ky limb blocks (about
+// sqrt(N) each way; a square only needs the k(k+1)/2 blocks on and above the diagonal) whose partial
+// products run on the pool at once and are then added into one exact product, rounded once into the
+// destination. With GMP's FFT multiply a block costs about 1/k of the whole product, so this buys
+// ~k times less wall time for ~k times the work. Opening one makes it current on its thread.
+constexpr size_t PAR_MUL_MIN_LIMBS = 4096; // smaller products finish before the threads wake up
+
+class ParallelMul {
+public:
+    explicit ParallelMul(unsigned threads)
+        : threads_(std::max(2u, threads)), pool_(threads_, nullptr, [this](unsigned, size_t i) { job_(i); }), prev_(current()) {
+        current() = this;
+    }
+    ~ParallelMul() { current() = prev_; }
+    ParallelMul(const ParallelMul&) = delete;
+    ParallelMul& operator=(const ParallelMul&) = delete;
+
+    static ParallelMul*& current() {
+        thread_local ParallelMul* p = nullptr;
+        return p;
+    }
+
+    // r = x * y correctly rounded (x == y squares); false when the operands are too small or not
+    // regular, and the caller should use MPFR
+    bool mul(mpfr_ptr r, mpfr_srcptr x, mpfr_srcptr y) {
+        if (!mpfr_regular_p(x) || !mpfr_regular_p(y)) return false;
+        size_t nx = mpfr_custom_get_size(mpfr_get_prec(x)) / sizeof(mp_limb_t);
+        size_t ny = mpfr_custom_get_size(mpfr_get_prec(y)) / sizeof(mp_limb_t);
+        if (std::min(nx, ny) < PAR_MUL_MIN_LIMBS) return false;
+        bool square = x == y;
+        const mp_limb_t* xp = static_cast<const mp_limb_t*>(mpfr_custom_get_significand(x));
+        const mp_limb_t* yp = static_cast<const mp_limb_t*>(mpfr_custom_get_significand(y));
+        size_t ky = 1; // y blocks; x is cut into kx blocks
+        while (square ? (ky + 1) * (ky + 2) / 2 <= threads_ : (ky + 1) * (ky + 1) <= threads_) ++ky;
+        size_t kx = square ? ky : threads_ / ky;
+        if (kx * ky == 1) return false; // a square needs 3 threads
+        size_t cx = (nx + kx - 1) / kx, cy = (ny + ky - 1) / ky;
+        struct Block { size_t i, j; std::vector<mp_limb_t> prod; };
+        std::vector<Block> blocks;
+        for (size_t i = 0; i < kx; ++i) {
+            for (size_t j = square ? i : 0; j < ky; ++j) {
+                if (i * cx < nx && j * cy < ny) blocks.push_back({ i, j, {} });
+            }
+        }
+        job_ = [&](size_t b) {
+            Block& bl = blocks[b];
+            const mp_limb_t* u = xp + bl.i * cx;
+            const mp_limb_t* v = yp + bl.j * cy;
+            size_t un = std::min(cx, nx - bl.i * cx), vn = std::min(cy, ny - bl.j * cy);
+            TRACE_SCOPE("mul block", "parallel", static_cast<mpfr_prec_t>((un + vn) * GMP_NUMB_BITS));
+            bl.prod.resize(un + vn);
+            if (square && bl.i == bl.j) mpn_sqr(bl.prod.data(), u, un);
+            else if (un >= vn) mpn_mul(bl.prod.data(), u, un, v, vn);
+            else mpn_mul(bl.prod.data(), v, vn, u, un);
+        };
+        pool_.run(blocks.size());
+        size_t n = nx + ny;
+        std::vector<mp_limb_t> prod(n, 0);
+        for (const Block& bl : blocks) {
+            size_t off = bl.i * cx + bl.j * cy;
+            for (int twice = square && bl.i != bl.j ? 2 : 1; twice > 0; --twice) {
+                mpn_add(prod.data() + off, prod.data() + off, n - off, bl.prod.data(), bl.prod.size());
+            }
+        }
+        mpfr_exp_t e = mpfr_get_exp(x) + mpfr_get_exp(y);
+        if (!(prod[n - 1] >> (GMP_NUMB_BITS - 1))) { // product of two mantissas in [1/2, 1) is in [1/4, 1)
+            mpn_lshift(prod.data(), prod.data(), n, 1);
+            --e;
+        }
+        int sign = mpfr_signbit(x) != mpfr_signbit(y) ? -1 : 1;
+        mpfr_t exact;
+        mpfr_custom_init_set(exact, sign * MPFR_REGULAR_KIND, e, static_cast<mpfr_prec_t>(n * GMP_NUMB_BITS), prod.data());
+        mpfr_set(r, exact, MPFR_RNDN);
+        return true;
+    }
+
+private:
+    unsigned threads_;
+    std::function<void(size_t)> job_;
+    WorkStealingPool pool_;
+    ParallelMul* prev_;
+};
+
+void big_mul(mpfr_ptr r, mpfr_srcptr x, mpfr_srcptr y) {
+    ParallelMul* pm = ParallelMul::current();
+    if (!pm || !pm->mul(r, x, y)) mpfr_mul(r, x, y, MPFR_RNDN);
+}
+
+void big_sqr(mpfr_ptr r, mpfr_srcptr x) {
+    ParallelMul* pm = ParallelMul::current();
+    if (!pm || !pm->mul(r, x, x)) mpfr_sqr(r, x, MPFR_RNDN);
+}
+
+// q = a / x correctly rounded, like mpfr_div, whose long division would otherwise keep a heron step
+// on one thread. With a ParallelMul open and operands big enough for its halved products: y ~= 1/x by
+// Newton (y += y * (1 - x*y), doubling precision up to h ~= p/2), q0 = a*y to h bits, then one
+// correction q1 = q0 + y * (a - x*q0) that doubles the correct bits, carried DIV_GUARD_BITS past p.
+// Every product goes through big_mul. mpfr_can_round decides whether rounding q1 to p gives the
+// correctly rounded quotient; in the rare case it cannot, mpfr_div answers. Either way the result is
+// bit-identical to --threads 1.
+constexpr mpfr_prec_t DIV_GUARD_BITS = 2 * SCHEDULE_GUARD_BITS;
 
-using mpfr::mpreal;
+void big_div(mpfr_ptr q, mpfr_srcptr a, mpfr_srcptr x) {
+    mpfr_prec_t p = mpfr_get_prec(q);
+    mpfr_prec_t h = p / 2 + 2 * DIV_GUARD_BITS;
+    size_t half_limbs = mpfr_custom_get_size(std::min(h, mpfr_get_prec(x))) / sizeof(mp_limb_t);
+    if (!ParallelMul::current() || !mpfr_regular_p(a) || !mpfr_regular_p(x) || half_limbs < PAR_MUL_MIN_LIMBS) {
+        mpfr_div(q, a, x, MPFR_RNDN);
+        return;
+    }
+    TRACE_SCOPE("parallel div", "parallel", p);
+    mpfr_prec_t px = mpfr_get_prec(x);
+    mpreal yv(0, SEED_PREC_BITS), xwv(0, h), ev(0, h), q0v(0, h), rv(0, px + h), q1v(0, p + DIV_GUARD_BITS);
+    mpfr_ptr y = yv.mpfr_ptr(), xw = xwv.mpfr_ptr(), e = ev.mpfr_ptr(), q0 = q0v.mpfr_ptr(), r = rv.mpfr_ptr(), q1 = q1v.mpfr_ptr();
+    // double seed for 1/x, then the ramp h, h/2 + guard, ... up from the seed
+    long ex;
+    double mx = mpfr_get_d_2exp(&ex, x, MPFR_RNDN);
+    mpfr_set_d(y, 1.0 / mx, MPFR_RNDN);
+    mpfr_mul_2si(y, y, -ex, MPFR_RNDN);
+    std::vector<mpfr_prec_t> ramp;
+    for (mpfr_prec_t w = h; w > SEED_PREC_BITS - 3; w = w / 2 + SCHEDULE_GUARD_BITS) ramp.push_back(w);
+    for (auto w = ramp.rbegin(); w != ramp.rend(); ++w) {
+        mpfr_set_prec(xw, *w);
+        mpfr_set(xw, x, MPFR_RNDN);
+        mpfr_set_prec(e, *w);
+        big_mul(e, xw, y);
+        mpfr_ui_sub(e, 1, e, MPFR_RNDN); // 1 - x*y, ~2^-(bits of y): only the bits above 2^-w matter
+        if (!mpfr_zero_p(e)) mpfr_prec_round(e, std::max<mpfr_prec_t>(*w + mpfr_get_exp(e), 0) + SCHEDULE_GUARD_BITS, MPFR_RNDN);
+        big_mul(e, e, y);
+        mpfr_prec_round(y, *w, MPFR_RNDN);
+        mpfr_add(y, y, e, MPFR_RNDN);
+    }
+    mpfr_set_prec(xw, h);
+    mpfr_set(xw, a, MPFR_RNDN); // q0 only needs h bits of a
+    big_mul(q0, xw, y);
+    big_mul(r, x, q0); // exact: px + h bits
+    mpfr_sub(r, a, r, MPFR_RNDN);
+    mpfr_prec_round(r, h, MPFR_RNDN);
+    big_mul(r, r, y);
+    mpfr_add(q1, q0, r, MPFR_RNDN);
+    // |q1 - a/x| < 2^(EXP(q1) - p - DIV_GUARD_BITS + 2); RNDZ at p + 1 bits decides RNDN at p
+    if (mpfr_can_round(q1, p + DIV_GUARD_BITS - 2, MPFR_RNDN, MPFR_RNDZ, p + 1)) mpfr_set(q, q1, MPFR_RNDN);
+    else mpfr_div(q, a, x, MPFR_RNDN);
+}
 
-// Convert decimal digits to bits (roughly)
-inline unsigned long digits_to_bits(unsigned long dec_digits) {
-    constexpr long double LOG2_10 = 3.321928094887362347870319429489L; // log2(10)
-    return static_cast<unsigned long>(std::ceil(dec_digits * LOG2_10));
+// Digits printed per value: --digits-out, capped at the computed precision
+size_t output_digits(const Options& opt) {
+    return (opt.digits_out == 0 || opt.digits_out > opt.prec_digits) ? opt.prec_digits : opt.digits_out;
 }
 
-// Independent high-resolution timer: runs a callable and returns pair(result, elapsed_ns)
-template<typename F>
-auto time_in_ns(F&& f) -> std::pair<decltype(f()), long long> {
-    using namespace std::chrono;
-    auto t0 = high_resolution_clock::now();
-    decltype(f()) result = f();
-    auto t1 = high_resolution_clock::now();
-    long long ns = duration_cast<nanoseconds>(t1 - t0).count();
-    return { result, ns };
+// Per-thread batch state: scratch numbers reused across inputs and one reused formatting stream and
+// decimal buffer (the seeds are rebuilt per input, so they are locals of process_batch_item)
+struct BatchScratch {
+    mpreal a;
+    KernelScratch kernel;
+    std::ostringstream os;
+    DecimalFormatter dec;
+};
+
+// One batch input; filled in by whichever worker handled it, printed in input order
+struct BatchItem {
+    unsigned long line_no = 0;
+    std::string input;
+    std::string line;  // result line without the trailing newline
+    std::string error; // non-empty -> reported on stderr
+    long long ns = 0;
+};
+
+void process_batch_item(const Options& opt, const KernelPlan& plan, BatchScratch& sc, BatchItem& item, ResultCache* cache) {
+    ArenaScope arena(opt.arena); // first local: closes (and rewinds) after every other local is gone
+    if (opt.mode == "isqrt") {
+        Mpz root, rem;
+        auto t = time_in_ns([&]() { return integer_sqrtrem(item.input, root.v, rem.v); });
+        if (!t.first) {
+            item.error = "line " + std::to_string(item.line_no) + ": not a non-negative integer: " + item.input;
+            item.line = item.input + " nan nan 0";
+            return;
+        }
+        item.ns = t.second;
+        item.line = item.input + ' ' + mpz_to_string(root.v) + ' ' + mpz_to_string(rem.v) + ' ' + std::to_string(t.second);
+        return;
+    }
+    const char* problem = nullptr;
+    if (mpfr_set_str(sc.a.mpfr_ptr(), item.input.c_str(), 10, MPFR_RNDN) != 0) problem = "failed to parse number";
+    else if (sc.a < 0) problem = "negative input";
+    if (problem) {
+        item.error = "line " + std::to_string(item.line_no) + ": " + problem + ": " + item.input;
+        item.line = item.input + " nan 0 0";
+        return;
+    }
+    if (opt.int_path && !opt.inverse) {
+        Mpz root;
+        if (exact_integer_root(item.input, root.v, opt.root)) {
+            mpreal exact(0, plan.bits);
+            mpfr_set_z(exact.mpfr_ptr(), root.v, MPFR_RNDN);
+            sc.os.str("");
+            sc.os << item.input << ' ' << sc.dec(exact) << " 0 0";
+            item.line = sc.os.str();
+            return;
+        }
+    }
+    std::string key;
+    if (cache) {
+        key = cache_key(opt, plan, item.input);
+        mpreal cached(0, plan.bits);
+        int used = 0;
+        if (cache->lookup(key, plan.bits, cached, used)) {
+            // a hit may be a finer run rounded to plan.bits (rounded twice), so it is checked as well
+            if (!opt.verify.empty()) verify_rounding(sc.a.mpfr_srcptr(), cached);
+            sc.os.str("");
+            sc.os << item.input << ' ' << sc.dec(cached) << ' ' << used << " 0";
+            item.line = sc.os.str();
+            return;
+        }
+    }
+    mpreal x0, y0;
+    if (!plan.builtin) prepare_seeds(opt, sc.a, x0, y0); // seed options were validated by run_batch
+    SqrtRun run = run_method(opt, plan, sc.a, x0, y0, nullptr, &sc.kernel);
+    if (!opt.verify.empty()) verify_rounding(sc.a.mpfr_srcptr(), run.approx);
+    item.ns = run.elapsed_ns;
+    if (cache) cache->insert(key, run.approx, run.iterations_used, plan.stop.enabled && run.iterations_used < opt.iterations);
+    sc.os.str("");
+    sc.os << item.input << ' ' << sc.dec(run.approx) << ' ' << run.iterations_used << ' ' << run.elapsed_ns;
+    item.line = sc.os.str();
 }
 
-// Newton/Heron iterations for sqrt(a): x_{n+1} = 0.5*(x_n + a/x_n)
-std::pair<mpreal, std::vector<mpreal>> newton_heron(const mpreal& a, mpreal x0, int iterations) {
-    std::vector<mpreal> its;
-    its.reserve(std::max(1, iterations));
-    mpreal x = x0;
-    its.push_back(x);
-    for (int i = 0; i < iterations; ++i) {
-        if (x == 0) { // avoid division by zero
-            x = mpreal(0);
-            its.push_back(x);
-            continue;
+// --batch: one decimal number per line from a file ("-" = stdin), one compact line per input:
+//   <input> <sqrt> <iterations used> <kernel ns>
+// Precision, schedule and stop rule are set up once; a, x0 and y0 are reused across inputs. No
+// reference or per-iteration table is computed. Unparsable or negative inputs print "nan" and are
+// reported on stderr with their line number. Perfect-square integers are answered exactly
+// (0 iterations, 0 ns). With --mode isqrt the line is <input> <floor(sqrt)> <remainder> <ns>.
+// With --threads N > 1 inputs are read in blocks and spread over a WorkStealingPool; results are
+// buffered per block and printed in input order, so the output does not depend on N.
+int run_batch(const Options& opt, const KernelPlan& plan) {
+    std::ifstream file;
+    if (opt.batch != "-") {
+        file.open(opt.batch);
+        if (!file) {
+            std::cerr << "Could not open batch input: " << opt.batch << "\n";
+            return 1;
+        }
+    }
+    std::istream& in = (opt.batch == "-") ? std::cin : file;
+
+    {
+        // seed options do not depend on the input: reject them once, not once per line
+        mpreal probe(1), x0, y0;
+        if (!prepare_seeds(opt, probe, x0, y0)) return 1;
+    }
+
+    unsigned threads = opt.threads ? opt.threads : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<BatchScratch> scratch(threads); // constructed here at the default precision (bits)
+    for (auto& sc : scratch) {
+        sc.dec.set_digits(output_digits(opt));
+        sc.kernel.reserve(plan.bits);
+    }
+
+    std::unique_ptr<ResultCache> cache = make_cache(opt);
+    std::vector<BatchItem> block;
+    std::unique_ptr<WorkStealingPool> pool;
+    if (threads > 1) {
+        unsigned long prec = plan.bits;
+        pool.reset(new WorkStealingPool(threads,
+            [prec](unsigned) { mpfr::mpreal::set_default_prec(prec); }, // default precision is per thread
+            [&](unsigned w, size_t i) { process_batch_item(opt, plan, scratch[w], block[i], cache.get()); }));
+    }
+    const size_t block_size = threads > 1 ? 256 * static_cast<size_t>(threads) : 1;
+
+    unsigned long line_no = 0, count = 0, failed = 0;
+    long long total_ns = 0;
+    auto flush_block = [&]() {
+        if (pool) pool->run(block.size());
+        else for (auto& item : block) process_batch_item(opt, plan, scratch[0], item, cache.get());
+        for (const auto& item : block) {
+            if (!item.error.empty()) {
+                std::cerr << item.error << "\n";
+                ++failed;
+            }
+            std::cout << item.line << '\n';
+            total_ns += item.ns;
         }
-        mpreal xnext = (x + a / x) * mpreal(0.5);
-        its.push_back(xnext);
-        x = xnext;
+        block.clear();
+    };
+
+    std::string line;
+    while (std::getline(in, line)) {
+        ++line_no;
+        size_t b = line.find_first_not_of(" \t\r");
+        if (b == std::string::npos || line[b] == '#') continue; // blank line or comment
+        size_t e = line.find_last_not_of(" \t\r");
+        ++count;
+        BatchItem item;
+        item.line_no = line_no;
+        item.input = line.substr(b, e - b + 1);
+        block.push_back(std::move(item));
+        if (block.size() >= block_size) flush_block();
     }
-    return { x, its };
+    flush_block();
+    pool.reset(); // joins the workers, which folds their arena stats into the totals
+    std::cout.flush();
+    std::cerr << "Batch: " << count << " inputs, " << failed << " failed, " << threads << " thread(s), kernel time "
+        << total_ns << " ns\n";
+    if (opt.arena) std::cerr << format_arena_stats(GmpArena::total(thread_arena())) << "\n";
+    finish_cache(opt, cache.get());
+    return failed == 0 ? 0 : 2;
 }
 
-// Reciprocal sqrt iterations: y_{n+1} = y_n * (1.5 - 0.5 * a * y_n^2), sqrt = a * y
-std::pair<mpreal, std::vector<mpreal>> reciprocal_sqrt(const mpreal& a, mpreal y0, int iterations) {
-    std::vector<mpreal> its;
-    its.reserve(std::max(1, iterations));
-    mpreal y = y0;
-    its.push_back(y);
-    for (int i = 0; i < iterations; ++i) {
-        mpreal y2 = y * y;
-        mpreal ynext = y * (mpreal(1.5) - mpreal(0.5) * a * y2);
-        its.push_back(ynext);
-        y = ynext;
+// Split "a,b,c" into its non-empty items
+std::vector<std::string> split_list(const std::string& s, char sep = ',') {
+    std::vector<std::string> out;
+    std::string item;
+    std::istringstream is(s);
+    while (std::getline(is, item, sep)) {
+        if (!item.empty()) out.push_back(item);
     }
-    mpreal sqrt_approx = a * y; // sqrt(a) = a * (1/sqrt(a))
-    return { sqrt_approx, its };
+    return out;
 }
 
-// Create an automatic initial guess based on the binary exponent (bit-length style seed)
-mpreal auto_initial_guess(const mpreal& a) {
-    if (a == 0) return mpreal(0);
-    if (a < 0) {
-        throw std::runtime_error("auto_initial_guess: negative input");
+// Summary of repeated timings
+struct BenchStats {
+    long long min_ns = 0, median_ns = 0, p95_ns = 0, mad_ns = 0;
+    double mean_ns = 0;
+};
+
+BenchStats summarize_ns(std::vector<long long> v) {
+    BenchStats st;
+    if (v.empty()) return st;
+    std::sort(v.begin(), v.end());
+    size_t n = v.size();
+    auto median_of = [](const std::vector<long long>& s) {
+        size_t m = s.size();
+        return (m % 2) ? s[m / 2] : (s[m / 2 - 1] + s[m / 2]) / 2;
+    };
+    st.min_ns = v.front();
+    st.median_ns = median_of(v);
+    st.p95_ns = v[static_cast<size_t>(std::ceil(0.95 * n)) - 1];
+    double sum = 0;
+    for (long long x : v) sum += static_cast<double>(x);
+    st.mean_ns = sum / n;
+    std::vector<long long> dev(n);
+    for (size_t i = 0; i < n; ++i) dev[i] = std::llabs(v[i] - st.median_ns);
+    std::sort(dev.begin(), dev.end());
+    st.mad_ns = median_of(dev);
+    return st;
+}
+
+// One row of --bench output
+struct BenchRow {
+    unsigned long digits = 0;
+    mpfr_prec_t bits = 0;
+    std::string method;
+    int iterations_used = 0;
+    BenchStats st;
+};
+
+// Results are folded into this so no timed call can be treated as dead code
+volatile long bench_sink = 0;
+
+// --bench: sweep --bench-digits x --bench-methods for --number. Each cell runs --warmup untimed calls,
+// then --reps timed calls of the kernel alone (seeds are prepared before timing; no reference, no
+// printing), reusing one KernelScratch like batch mode. "mpfr" times mpfr_sqrt as a baseline.
+// Writes CSV or JSON (--bench-format) to --bench-out or stdout.
+int run_bench(const Options& opt) {
+    if (opt.inverse) {
+        std::cerr << "--inverse cannot be combined with --bench\n";
+        return 1;
     }
-    // compute approximate floor(log2(a)) via mpfr log and convert to long long safely
-    mpreal log2a = log(a) / log(mpreal(2));
-    long long exp_floor = static_cast<long long>(std::floor(log2a.toDouble()));
-    // seed exponent = ceil((exp_floor + 1)/2) -> integer formula (exp_floor + 2)/2
-    long long seed_exp = (exp_floor + 2) / 2;
-    mpreal x0 = pow(mpreal(2), mpreal(seed_exp));
-    return x0;
+    std::vector<std::string> methods = split_list(opt.bench_methods);
+    std::vector<unsigned long> digit_list;
+    try {
+        for (const auto& d : split_list(opt.bench_digits)) digit_list.push_back(std::stoul(d));
+    }
+    catch (...) {
+        std::cerr << "Invalid --bench-digits: " << opt.bench_digits << "\n";
+        return 1;
+    }
+    for (const auto& m : methods) {
+        if (m != "heron" && m != "recip" && m != "karp" && m != "mpfr" && m != "pow" && m != "heron-fixed" && m != "recip-fixed") {
+            std::cerr << "Unknown bench method: " << m << "\n";
+            return 1;
+        }
+        if (opt.root != 2 && m != "heron" && m != "recip" && m != "mpfr" && m != "pow") {
+            std::cerr << "bench method " << m << " cannot be combined with --root " << opt.root << "\n";
+            return 1;
+        }
+    }
+    if (opt.bench_format != "csv" && opt.bench_format != "json") {
+        std::cerr << "Unknown bench format: " << opt.bench_format << "\n";
+        return 1;
+    }
+    int reps = std::max(1, opt.bench_reps);
+
+    std::vector<BenchRow> rows;
+    for (unsigned long digits : digit_list) {
+        mpfr_prec_t bits = digits_to_bits(digits);
+        mpfr::mpreal::set_default_prec(bits);
+        KernelPlan plan;
+        if (!make_plan(opt, bits, plan)) return 1;
+        mpreal a;
+        if (mpfr_set_str(a.mpfr_ptr(), opt.number.c_str(), 10, MPFR_RNDN) != 0 || a < 0) {
+            std::cerr << "Invalid or negative --number for bench: " << opt.number << "\n";
+            return 1;
+        }
+        KernelScratch scratch;
+        scratch.reserve(bits);
+        mpreal builtin(0, bits), root_n(static_cast<double>(opt.root), bits);
+
+        for (const auto& m : methods) {
+            Options mopt = opt;
+            mopt.method = m == "mpfr" || m == "pow" ? "heron" : m;
+            KernelPlan mplan = plan;
+            if (m == "heron-fixed" || m == "recip-fixed") {
+                if (!fixed_size_bits(bits)) {
+                    std::cerr << "bench " << digits << " digits " << m << ": skipped (fixed kernels go up to " << FIXED_MAX_BITS << " bits)\n";
+                    continue;
+                }
+                mopt.method = m.substr(0, m.find('-'));
+                mplan.fixed = true;
+            }
+            mpreal x0, y0;
+            if (!prepare_seeds(mopt, a, x0, y0)) return 1;
+
+            BenchRow row;
+            row.digits = digits;
+            row.bits = bits;
+            row.method = m;
+            auto once = [&]() -> long long {
+                ArenaScope arena(opt.arena);
+                if (m == "mpfr") {
+                    auto t = time_in_ns([&]() { builtin_root(builtin.mpfr_ptr(), a.mpfr_srcptr(), opt.root, opt.inverse); return 0; });
+                    bench_sink = bench_sink + mpfr_get_exp(builtin.mpfr_srcptr());
+                    return t.second;
+                }
+                if (m == "pow") { // generic a^(1/N), what callers without a root kernel pay
+                    auto t = time_in_ns([&]() {
+                        mpfr_ui_div(builtin.mpfr_ptr(), 1, root_n.mpfr_srcptr(), MPFR_RNDN);
+                        return mpfr_pow(builtin.mpfr_ptr(), a.mpfr_srcptr(), builtin.mpfr_srcptr(), MPFR_RNDN);
+                    });
+                    bench_sink = bench_sink + mpfr_get_exp(builtin.mpfr_srcptr());
+                    return t.second;
+                }
+                SqrtRun run = run_method(mopt, mplan, a, x0, y0, nullptr, &scratch);
+                row.iterations_used = run.iterations_used;
+                bench_sink = bench_sink + mpfr_get_exp(run.approx.mpfr_srcptr());
+                return run.elapsed_ns;
+            };
+            for (int w = 0; w < opt.bench_warmup; ++w) once();
+            std::vector<long long> samples;
+            samples.reserve(reps);
+            for (int r = 0; r < reps; ++r) samples.push_back(once());
+            row.st = summarize_ns(samples);
+            rows.push_back(row);
+            std::cerr << "bench " << digits << " digits " << m << ": median " << row.st.median_ns << " ns\n";
+        }
+    }
+
+    std::ofstream file;
+    if (!opt.bench_out.empty()) {
+        file.open(opt.bench_out);
+        if (!file) {
+            std::cerr << "Could not open file for writing: " << opt.bench_out << "\n";
+            return 1;
+        }
+    }
+    std::ostream& out = opt.bench_out.empty() ? std::cout : file;
+    if (opt.bench_format == "csv") {
+        out << "number,digits,bits,method,schedule,iterations_used,reps,min_ns,median_ns,p95_ns,mad_ns,mean_ns\n";
+        for (const auto& r : rows) {
+            out << opt.number << "," << r.digits << "," << r.bits << "," << r.method << "," << opt.precision_schedule << ","
+                << r.iterations_used << "," << reps << "," << r.st.min_ns << "," << r.st.median_ns << "," << r.st.p95_ns << ","
+                << r.st.mad_ns << "," << std::fixed << std::setprecision(1) << r.st.mean_ns << "\n";
+        }
+    }
+    else {
+        out << "{\n  \"number\": \"" << opt.number << "\",\n  \"root\": " << opt.root << ",\n  \"schedule\": \"" << opt.precision_schedule
+            << "\",\n  \"until_converged\": " << (opt.until_converged ? "true" : "false")
+            << ",\n  \"warmup\": " << opt.bench_warmup << ",\n  \"reps\": " << reps << ",\n  \"results\": [\n";
+        for (size_t i = 0; i < rows.size(); ++i) {
+            const auto& r = rows[i];
+            out << "    {\"digits\": " << r.digits << ", \"bits\": " << r.bits << ", \"method\": \"" << r.method
+                << "\", \"iterations_used\": " << r.iterations_used << ", \"min_ns\": " << r.st.min_ns
+                << ", \"median_ns\": " << r.st.median_ns << ", \"p95_ns\": " << r.st.p95_ns << ", \"mad_ns\": " << r.st.mad_ns
+                << ", \"mean_ns\": " << std::fixed << std::setprecision(1) << r.st.mean_ns << "}" << (i + 1 < rows.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+    return 0;
 }
 
-// Write iterations to CSV: iteration,value,abs_error,rel_error
-void save_iterations_csv(const std::string& file, const std::vector<mpreal>& its, const mpreal& reference, unsigned int print_digits) {
-    std::ofstream ofs(file);
-    if (!ofs) {
-        std::cerr << "Could not open file for writing: " << file << "\n";
-        return;
+// Scalar members of a flat JSON object (one --serve request line). Strings are unescaped; numbers,
+// true, false and null are kept as their literal text. Nested objects and arrays are rejected.
+bool parse_json_object(const std::string& text, std::map<std::string, std::string>& out, std::string& err) {
+    size_t p = 0;
+    auto ws = [&]() { while (p < text.size() && std::isspace(static_cast<unsigned char>(text[p]))) ++p; };
+    auto parse_string = [&](std::string& s) -> bool {
+        if (p >= text.size() || text[p] != '"') return false;
+        ++p;
+        s.clear();
+        while (p < text.size() && text[p] != '"') {
+            char c = text[p++];
+            if (c != '\\') { s += c; continue; }
+            if (p >= text.size()) return false;
+            char e = text[p++];
+            switch (e) {
+            case '"': case '\\': case '/': s += e; break;
+            case 'b': s += '\b'; break;
+            case 'f': s += '\f'; break;
+            case 'n': s += '\n'; break;
+            case 'r': s += '\r'; break;
+            case 't': s += '\t'; break;
+            case 'u': {
+                if (p + 4 > text.size()) return false;
+                unsigned long cp = std::strtoul(text.substr(p, 4).c_str(), nullptr, 16);
+                p += 4;
+                if (cp < 0x80) s += static_cast<char>(cp);
+                else if (cp < 0x800) { s += static_cast<char>(0xC0 | (cp >> 6)); s += static_cast<char>(0x80 | (cp & 0x3F)); }
+                else { s += static_cast<char>(0xE0 | (cp >> 12)); s += static_cast<char>(0x80 | ((cp >> 6) & 0x3F)); s += static_cast<char>(0x80 | (cp & 0x3F)); }
+                break;
+            }
+            default: return false;
+            }
+        }
+        if (p >= text.size()) return false;
+        ++p; // closing quote
+        return true;
+    };
+
+    ws();
+    if (p >= text.size() || text[p] != '{') { err = "request must be a JSON object"; return false; }
+    ++p;
+    ws();
+    if (p < text.size() && text[p] == '}') return true;
+    while (true) {
+        std::string key, value;
+        ws();
+        if (!parse_string(key)) { err = "malformed JSON key"; return false; }
+        ws();
+        if (p >= text.size() || text[p] != ':') { err = "expected ':' after \"" + key + "\""; return false; }
+        ++p;
+        ws();
+        if (p < text.size() && text[p] == '"') {
+            if (!parse_string(value)) { err = "malformed JSON string for \"" + key + "\""; return false; }
+        }
+        else if (p < text.size() && (text[p] == '{' || text[p] == '[')) {
+            err = "nested JSON values are not supported (\"" + key + "\")";
+            return false;
+        }
+        else {
+            size_t start = p;
+            while (p < text.size() && text[p] != ',' && text[p] != '}' && !std::isspace(static_cast<unsigned char>(text[p]))) ++p;
+            value = text.substr(start, p - start);
+            if (value.empty()) { err = "missing JSON value for \"" + key + "\""; return false; }
+        }
+        out[key] = value;
+        ws();
+        if (p < text.size() && text[p] == ',') { ++p; continue; }
+        if (p < text.size() && text[p] == '}') return true;
+        err = "expected ',' or '}' in JSON object";
+        return false;
     }
-    ofs << "iteration,value,abs_error,rel_error" << '\n';
-    ofs << std::setprecision(print_digits) << std::scientific;
-    for (size_t i = 0; i < its.size(); ++i) {
-        mpreal val = its[i];
-        mpreal abs_err = abs(val - reference);
-        mpreal rel_err = reference == 0 ? mpreal(0) : abs_err / abs(reference);
-        ofs << i << "," << val << "," << abs_err << "," << rel_err << '\n';
+}
+
+std::string json_escape(const std::string& s) {
+    std::string out;
+    out.reserve(s.size() + 2);
+    for (char c : s) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(static_cast<unsigned char>(c)));
+                out += buf;
+            }
+            else out += c;
+        }
     }
-    ofs.close();
+    return out;
 }
 
-// Small CLI option parser (very simple)
-struct Options {
-    std::string number = "2";
-    unsigned long prec_digits = 100; // decimal digits of precision
-    int iterations = 20;
-    std::string init_mode = "auto"; // auto | manual | reciprocal-seed
-    std::string init_value = ""; // used when init_mode==manual
-    std::string method = "heron"; // heron | recip
-    std::string save_csv = "";
-    bool show_help = false;
+// Redirects std::cerr into a string while alive, so --serve can return the diagnostics the shared
+// validation code prints (make_plan, prepare_seeds, ...) inside the JSON response
+class CerrCapture {
+public:
+    CerrCapture() : old_(std::cerr.rdbuf(buf_.rdbuf())) {}
+    ~CerrCapture() { std::cerr.rdbuf(old_); }
+
+    std::string text() const {
+        std::string t = buf_.str();
+        while (!t.empty() && (t.back() == '\n' || t.back() == ' ')) t.pop_back();
+        return t;
+    }
+
+private:
+    std::ostringstream buf_;
+    std::streambuf* old_;
 };
 
-Options parse_args(int argc, char** argv) {
-    Options opt;
-    for (int i = 1; i < argc; ++i) {
-        std::string a = argv[i];
-        if (a == "--help" || a == "-h") { opt.show_help = true; break; }
-        if (a == "--number" && i + 1 < argc) opt.number = argv[++i];
-        else if (a == "--prec-digits" && i + 1 < argc) opt.prec_digits = static_cast<unsigned long>(std::stoul(argv[++i]));
-        else if (a == "--iterations" && i + 1 < argc) opt.iterations = std::stoi(argv[++i]);
-        else if (a == "--init-mode" && i + 1 < argc) opt.init_mode = argv[++i];
-        else if (a == "--init-value" && i + 1 < argc) opt.init_value = argv[++i];
-        else if (a == "--method" && i + 1 < argc) opt.method = argv[++i];
-        else if (a == "--save-csv" && i + 1 < argc) opt.save_csv = argv[++i];
-        else {
-            std::cerr << "Unknown or incomplete argument: " << a << "\n";
-            opt.show_help = true;
-            break;
+// One --serve request: the JSON members of app.py's /api/sqrt (number, prec_digits, iterations,
+// method, init_mode, init_value, include_iterations) plus precision_schedule, until_converged, tol,
+// mode, root, inverse and an optional id echoed back. Fields left out keep the command-line value.
+// Under --verify cheap the result (fresh or cached) goes through verify_rounding before it is returned.
+// Requests come from the network, so nothing in them names a file: resume_from is refused, and
+// --resume-from / --cache-file stay command-line only. Returns the response object; failures are
+// {"error": ..., "status": 400}.
+// With a cache, requests without include_iterations can be answered from it ("cached": true); on a
+// miss, a lower-precision cached result for the same request seeds the run ("resumed_bits").
+std::string serve_request(const Options& base, const std::string& line, ResultCache* cache) {
+    std::map<std::string, std::string> req;
+    std::string err;
+    std::string id_field;
+    auto fail = [&](const std::string& msg) {
+        return "{" + id_field + "\"error\": \"" + json_escape(msg) + "\", \"status\": 400}";
+    };
+    if (!parse_json_object(line, req, err)) return fail(err);
+    if (req.count("id")) id_field = "\"id\": \"" + json_escape(req["id"]) + "\", ";
+    if (req.count("resume_from")) return fail("resume_from is not accepted in requests; use --resume-from when starting --serve");
+
+    Options opt = base;
+    bool include_iterations = true;
+    try {
+        if (req.count("number")) opt.number = req["number"];
+        if (req.count("prec_digits")) opt.prec_digits = std::stoul(req["prec_digits"]);
+        if (req.count("iterations")) opt.iterations = std::stoi(req["iterations"]);
+        if (req.count("method")) opt.method = req["method"];
+        if (req.count("init_mode")) opt.init_mode = req["init_mode"];
+        if (req.count("init_value")) opt.init_value = req["init_value"];
+        if (req.count("precision_schedule")) opt.precision_schedule = req["precision_schedule"];
+        if (req.count("until_converged")) opt.until_converged = req["until_converged"] == "true";
+        if (req.count("tol")) {
+            opt.tol = req["tol"] == "null" ? "" : req["tol"];
+            if (!opt.tol.empty()) opt.until_converged = true;
         }
+        if (req.count("mode")) opt.mode = req["mode"];
+        if (req.count("root")) opt.root = std::stoul(req["root"]);
+        if (req.count("inverse")) opt.inverse = req["inverse"] == "true";
+        if (req.count("include_iterations")) include_iterations = req["include_iterations"] == "true";
+        apply_large(opt);
     }
-    return opt;
+    catch (...) {
+        return fail("prec_digits, iterations and root must be integers");
+    }
+    if (opt.prec_digits < 1) return fail("prec_digits must be >= 1");
+    if (opt.iterations < 0) return fail("iterations must be >= 0");
+
+    CerrCapture diagnostics;
+    if (!check_method_options(opt)) return fail(diagnostics.text());
+    if (opt.mode == "isqrt") {
+        ArenaScope arena(opt.arena);
+        Mpz root, rem;
+        auto t = time_in_ns([&]() { return integer_sqrtrem(opt.number, root.v, rem.v); });
+        if (!t.first) return fail("mode isqrt needs a non-negative integer: " + opt.number);
+        return "{" + id_field + "\"input\": \"" + json_escape(opt.number) + "\", \"mode\": \"isqrt\", \"isqrt\": \""
+            + mpz_to_string(root.v) + "\", \"remainder\": \"" + mpz_to_string(rem.v) + "\", \"perfect_square\": "
+            + (mpz_sgn(rem.v) == 0 ? "true" : "false") + ", \"time_ns\": " + std::to_string(t.second) + "}";
+    }
+    mpfr_prec_t bits = digits_to_bits(opt.prec_digits);
+    mpfr::mpreal::set_default_prec(bits);
+    KernelPlan plan;
+    if (!make_plan(opt, bits, plan)) return fail(diagnostics.text());
+    plan.builtin = use_builtin_tier(opt, bits, include_iterations);
+    plan.fixed = !plan.builtin && use_fixed_tier(opt, bits, include_iterations);
+
+    ArenaScope arena(opt.arena); // declared before every value it serves
+    mpreal a_in;
+    if (!parse_number_odd(opt.number, input_parse_prec(bits), a_in)) return fail("Failed to parse number: " + opt.number);
+    mpreal a(0, bits);
+    mpfr_set(a.mpfr_ptr(), a_in.mpfr_srcptr(), MPFR_RNDN);
+    if (a < 0) return fail("Negative input: complex results not supported by this program.");
+    mpreal reference(0, bits);
+    build_reference(a_in.mpfr_srcptr(), bits, reference, opt.root, opt.inverse);
+    mpreal x0, y0;
+    if (!prepare_seeds(opt, a, x0, y0)) return fail(diagnostics.text());
+
+    // errors at the printed precision, so the response matches app.py's mpmath path digit for digit
+    ErrorMeter errors(reference, bits);
+    DecimalFormatter dec(output_digits(opt)), err_dec(output_digits(opt));
+    std::string key = cache ? cache_key(opt, plan, opt.number) : std::string();
+    SqrtRun run;
+    run.approx = mpreal(0, bits);
+    bool cached = cache && !include_iterations && cache->lookup(key, bits, run.approx, run.iterations_used);
+    if (cached && !opt.verify.empty()) verify_rounding(a.mpfr_srcptr(), run.approx); // as in process_batch_item
+    bool exact = false;
+    if (!cached && opt.int_path && !opt.inverse) {
+        Mpz root;
+        exact = exact_integer_root(opt.number, root.v, opt.root);
+        if (exact) mpfr_set_z(run.approx.mpfr_ptr(), root.v, MPFR_RNDN);
+    }
+    std::ostringstream its;
+    IterationSink sink;
+    if (include_iterations) {
+        sink = [&](int i, const mpreal& val) {
+            const IterateError& e = errors(val);
+            its << (i ? ", " : "") << "{\"i\": " << i << ", \"value\": \"" << dec(val) << "\", \"abs_err\": \""
+                << err_dec(e.abs_err) << "\", \"rel_err\": \"" << err_dec(e.rel_err) << "\"}";
+            };
+    }
+    mpfr_prec_t resumed_bits = 0;
+    if (!cached && !exact) {
+        // "more digits" requests: refine an earlier result instead of starting from the guess
+        mpreal seed;
+        if (!opt.resume_from.empty()) {
+            if (!read_last_bin_value(opt.resume_from, seed)) return fail(diagnostics.text());
+            resumed_bits = apply_resume_seed(opt, a, seed, bits, plan, x0, y0);
+        }
+        else if (cache && opt.root == 2 && !opt.inverse && cache->best_below(key, bits, seed)) { // seed_correct_bits is sqrt-only
+            resumed_bits = apply_resume_seed(opt, a, seed, bits, plan, x0, y0);
+        }
+        run = run_method(opt, plan, a, x0, y0, sink);
+        if (!opt.verify.empty()) verify_rounding(a.mpfr_srcptr(), run.approx);
+        if (cache) cache->insert(key, run.approx, run.iterations_used, plan.stop.enabled && run.iterations_used < opt.iterations);
+    }
+    mpreal builtin(0, bits);
+    builtin_root(builtin.mpfr_ptr(), a.mpfr_srcptr(), opt.root, opt.inverse);
+    const IterateError& final_err = errors(run.approx);
+
+    std::ostringstream out;
+    out << "{" << id_field << "\"input\": \"" << json_escape(opt.number) << "\", \"prec_digits\": " << opt.prec_digits
+        << ", \"method\": \"" << opt.method << "\"" << (opt.root != 2 ? ", \"root\": " + std::to_string(opt.root) : std::string())
+        << (opt.inverse ? ", \"inverse\": true" : "")
+        << ", \"iterations_requested\": " << opt.iterations
+        << ", \"iterations_used\": " << run.iterations_used << ", \"cached\": " << (cached ? "true" : "false")
+        << ", \"exact\": " << (exact ? "true" : "false")
+        << ", \"resumed_bits\": " << resumed_bits
+        << ", \"initial_guess_used\": \"" << dec(opt.method == "heron" ? x0 : y0) << "\", \"time_ns\": " << run.elapsed_ns
+        << ", \"reference\": \"" << dec(reference) << "\", \"builtin_sqrt\": \"" << dec(builtin)
+        << "\", \"approx\": \"" << dec(run.approx) << "\", \"abs_err\": \"" << err_dec(final_err.abs_err)
+        << "\", \"rel_err\": \"" << err_dec(final_err.rel_err) << "\"";
+    if (include_iterations) out << ", \"iterations\": [" << its.str() << "]";
+    out << "}";
+    return out.str();
 }
 
-void print_help() {
-    std::cout << "mpreal_sqrt_newton - high-precision sqrt via Newton/Herson and reciprocal-sqrt\n\n";
-    std::cout << "Usage:\n  ./mpreal_sqrt_newton [options]\n\n";
-    std::cout << "Options:\n";
-    std::cout << "  --number <value>        Number to compute sqrt of (decimal string). Default: 2\n";
-    std::cout << "  --prec-digits <n>       Decimal digits of precision (default 100)\n";
-    std::cout << "  --iterations <n>        Number of Newton iterations to run (default 20)\n";
-    std::cout << "  --init-mode <mode>      initial guess mode: auto | manual (default auto)\n";
-    std::cout << "  --init-value <val>      initial guess value if init-mode==manual (decimal string)\n";
-    std::cout << "  --method <heron|recip>  heron (Newton) or recip (reciprocal-sqrt). default: heron\n";
-    std::cout << "  --save-csv <file>       save iteration table to CSV file\n";
-    std::cout << "  --help, -h              show this help\n";
+// --serve: a warm worker for app.py. Reads one JSON request per line from stdin until EOF and answers
+// each with one JSON line on stdout, flushed immediately. Command-line options are the defaults for
+// fields a request leaves out; a bad request gets an error object and the worker keeps serving.
+int run_serve(const Options& opt) {
+    std::unique_ptr<ResultCache> cache = make_cache(opt);
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        std::string response = serve_request(opt, line, cache.get());
+        std::cout << response << '\n' << std::flush;
+    }
+    finish_cache(opt, cache.get());
+    return 0;
+}
+
+// --mode isqrt for --number: exact integer square root and remainder, no floating-point work
+int run_isqrt(const Options& opt) {
+    ArenaScope arena(opt.arena);
+    Mpz root, rem;
+    auto t = time_in_ns([&]() { return integer_sqrtrem(opt.number, root.v, rem.v); });
+    if (!t.first) {
+        std::cerr << "--mode isqrt needs a non-negative integer: " << opt.number << "\n";
+        return 1;
+    }
+    std::cout << "Input: " << input_label(opt) << "\n";
+    std::cout << "Mode: isqrt (mpz_sqrtrem)\n";
+    std::cout << "Time elapsed: " << t.second << " ns\n\n";
+    std::cout << "isqrt (floor): " << mpz_to_string(root.v) << "\n";
+    std::cout << "Remainder: " << mpz_to_string(rem.v) << "\n";
+    std::cout << "Perfect square: " << (mpz_sgn(rem.v) == 0 ? "yes" : "no") << "\n";
+    if (opt.arena) std::cout << format_arena_stats(GmpArena::total(thread_arena())) << "\n";
+    return 0;
+}
+
+#ifndef MPREAL_SQRT_NO_MAIN // library use: see sqrt_batch
+// Closes the last phase, writes the --trace file, then the --stats block (after the report on stdout, or to --stats-out)
+bool write_stats(const Options& opt, RunStats& stats) {
+    stats.end();
+    if (!opt.trace.empty() && !Tracer::instance().write(opt.trace)) {
+        std::cerr << "Cannot write trace file: " << opt.trace << "\n";
+        return false;
+    }
+    if (!opt.stats) return true;
+    if (opt.stats_out.empty()) {
+        std::cout << "\nStats:\n";
+        stats.write_json(std::cout, 0);
+        return true;
+    }
+    std::ofstream f(opt.stats_out);
+    if (f) stats.write_json(f, 0);
+    if (!f) {
+        std::cerr << "Cannot write stats file: " << opt.stats_out << "\n";
+        return false;
+    }
+    return true;
 }
 
 int main(int argc, char** argv) {
     Options opt = parse_args(argc, argv);
     if (opt.show_help) { print_help(); return 0; }
+    if (!check_method_options(opt)) return 1;
+    if (!opt.number_file.empty() && !read_number_file(opt.number_file, opt.number)) return 1;
+
+    if (opt.arena) install_arena_hooks();
+    if (!opt.spill_dir.empty()) {
+        if (opt.arena) {
+            std::cerr << "--spill-dir cannot be combined with --arena\n";
+            return 1;
+        }
+        if (!install_spill_hooks(opt.spill_dir)) return 1;
+    }
+#ifdef MPREAL_SQRT_NO_TRACE
+    if (!opt.trace.empty()) {
+        std::cerr << "--trace is not available: built with MPREAL_SQRT_NO_TRACE\n";
+        return 1;
+    }
+#endif
+    // on top of the arena / spill functions, so both are counted; --trace events carry byte counts too
+    if (opt.stats || !opt.trace.empty()) install_counting_hooks();
+    // stdout is only written through std::cout, so it can keep its own buffer; huge values then go
+    // out in one write instead of through stdio
+    std::ios::sync_with_stdio(false);
+    if (opt.bench) return run_bench(opt);
+    if (opt.serve) return run_serve(opt);
 
     // compute and set MPFR precision
     unsigned long bits = digits_to_bits(opt.prec_digits);
     mpfr::mpreal::set_default_prec(bits);
 
+    KernelPlan plan;
+    if (!make_plan(opt, bits, plan)) return 1;
+
+    // batch never shows iterates; a single run only with --quiet and no iterate files
+    bool iterates_wanted = opt.batch.empty() && (!opt.quiet || !opt.save_csv.empty() || !opt.save_bin.empty());
+    plan.builtin = use_builtin_tier(opt, bits, iterates_wanted);
+    plan.fixed = !plan.builtin && use_fixed_tier(opt, bits, iterates_wanted);
+
+    if (!opt.batch.empty()) return run_batch(opt, plan);
+    if (opt.mode == "isqrt") return run_isqrt(opt);
+
+    // one arena scope for the whole single-number run; declared before every value it serves
+    ArenaScope arena(opt.arena);
+
     // Parse input number
-    mpreal a;
-    try {
-        a = mpreal(opt.number);
-    }
-    catch (...) {
-        std::cerr << "Failed to parse number: " << opt.number << "\n";
+    if (!opt.trace.empty()) Tracer::instance().enable();
+    RunStats stats(opt.stats || !opt.trace.empty());
+    stats.begin("parse");
+    mpreal a_in; // every precision below is a rounding of this one parse
+    if (!parse_number_odd(opt.number, input_parse_prec(bits), a_in)) {
+        std::cerr << "Failed to parse number: " << input_label(opt) << "\n";
         return 1;
     }
+    mpreal a(0, bits);
+    mpfr_set(a.mpfr_ptr(), a_in.mpfr_srcptr(), MPFR_RNDN);
+    double a_double = mpfr_get_d(a_in.mpfr_srcptr(), MPFR_RNDN); // correctly rounded: a_in is rounded to odd
+    // std::sqrt is skipped outside the normal double range, where std::stod would have failed
+    bool double_ok = mpfr_zero_p(a_in.mpfr_srcptr()) || (std::isfinite(a_double) && std::fabs(a_double) >= DBL_MIN);
     if (a < 0) {
         std::cerr << "Negative input: complex results not supported by this program.\n";
         return 1;
     }
 
-    // Build a high-precision reference using extra precision
-    unsigned long extra_bits = 64; // extra bits for reference
-    unsigned long orig_prec = mpfr::mpreal::get_default_prec();
-    unsigned long ref_prec = orig_prec + extra_bits;
-    mpfr::mpreal::set_default_prec(ref_prec);
-    mpreal a_high = mpreal(opt.number); // construct at higher precision
-    mpreal ref_sqrt_high = mpfr::sqrt(a_high);
-    // bring reference back to original precision safely by capturing its string with many digits
-    std::ostringstream oss_ref;
-    unsigned long ref_print_digits = opt.prec_digits + 20; // print extra digits for reference
-    oss_ref << std::setprecision(static_cast<int>(ref_print_digits)) << std::scientific << ref_sqrt_high;
-    std::string ref_str = oss_ref.str();
-    // restore original precision
-    mpfr::mpreal::set_default_prec(orig_prec);
-    // parse reference string into mpreal at original precision for comparisons
-    mpreal reference;
-    try {
-        reference = mpreal(ref_str);
+    // Perfect-square integers have an exact answer: no reference, seeds, kernel or table
+    if (opt.int_path && !opt.inverse) {
+        Mpz root;
+        if (exact_integer_root(opt.number, root.v, opt.root)) {
+            mpreal exact(0, bits);
+            mpfr_set_z(exact.mpfr_ptr(), root.v, MPFR_RNDN);
+            DecimalFormatter dec(output_digits(opt));
+            std::cout << std::scientific;
+            std::cout << "Input: " << input_label(opt) << "\n";
+            std::cout << "Precision: " << opt.prec_digits << " decimal digits (" << bits << " bits)\n";
+            if (opt.root == 2) {
+                std::cout << "Perfect square: exact integer path (mpz_perfect_square_p), no iterations\n\n";
+                std::cout << "Exact integer sqrt: " << mpz_to_string(root.v) << "\n";
+            }
+            else {
+                std::cout << "Perfect " << opt.root << "-th power: exact integer path (mpz_root), no iterations\n\n";
+                std::cout << "Exact integer root: " << mpz_to_string(root.v) << "\n";
+            }
+            std::cout << "Final approx after iterations: " << dec(exact) << "\n";
+            return write_stats(opt, stats) ? 0 : 1;
+        }
     }
-    catch (...) {
-        // fallback: compute sqrt at normal precision
-        reference = mpfr::sqrt(a);
+
+    // --verify cheap replaces both optional comparisons
+    if (!opt.verify.empty()) opt.no_reference = true;
+    // --mem-limit: optional values that do not fit are skipped, the rest is freed as soon as possible
+    MemoryPlan mem = plan_memory(opt, bits);
+    if (!mem.reference) opt.no_reference = true;
+    std::string builtin_skipped = "skipped (--mem-limit)";
+    if (!opt.verify.empty()) {
+        mem.builtin = false;
+        builtin_skipped = "skipped (--verify cheap)";
+    }
+    if (opt.no_reference) shrink_value(a_in, MPFR_PREC_MIN);
+
+    // --threads N in a single run: the builtin sqrt, and the reference when no iterate needs it, run
+    // on helper threads next to the kernel, whose large products go through a ParallelMul
+    unsigned threads = opt.threads ? opt.threads : std::max(1u, std::thread::hardware_concurrency());
+    bool helpers = threads > 1;
+    bool ref_alongside = helpers && !opt.no_reference && !iterates_wanted;
+
+    // Build a high-precision reference using extra precision
+    mpreal reference(0, bits);
+    if (!opt.no_reference && !ref_alongside) {
+        stats.begin("reference");
+        build_reference(a_in.mpfr_srcptr(), bits, reference, opt.root, opt.inverse);
+        shrink_value(a_in, MPFR_PREC_MIN);
     }
+    const mpreal* ref = opt.no_reference ? nullptr : &reference;
 
     // Prepare initial guess
-    mpreal x0;
-    if (opt.init_mode == "manual") {
-        if (opt.init_value.empty()) {
-            std::cerr << "init-mode=manual but --init-value not provided\n";
-            return 1;
-        }
-        x0 = mpreal(opt.init_value);
+    stats.begin("seed");
+    mpreal x0, y0;
+    if (!prepare_seeds(opt, a, x0, y0)) return 1;
+    mpfr_prec_t resumed_bits = 0;
+    if (!opt.resume_from.empty()) {
+        mpreal seed;
+        if (!read_last_bin_value(opt.resume_from, seed)) return 1;
+        resumed_bits = apply_resume_seed(opt, a, seed, bits, plan, x0, y0);
     }
-    else {
-        // auto or other modes -> use automatic pre-seed
-        x0 = auto_initial_guess(a);
+
+    // summary, writers, helper threads and the ParallelMul pool: everything up to the kernel call
+    stats.begin("setup");
+
+    // Print summary
+    DecimalFormatter dec(output_digits(opt));
+    std::cout << std::scientific;
+    std::cout << "Input: " << input_label(opt) << "\n";
+    std::cout << "Precision: " << opt.prec_digits << " decimal digits (" << bits << " bits)\n";
+    std::cout << "Method: " << opt.method << ", iterations requested: " << opt.iterations << "\n";
+    std::string root_name = opt.inverse ? (opt.root == 2 ? "rec_sqrt" : "1/rootn_ui") : opt.root == 2 ? "sqrt" : "rootn_ui";
+    if (opt.root != 2) {
+        std::cout << "Root: " << opt.root << " (" << (opt.method == "recip" ? "inverse-root iteration" : "Newton")
+            << ", nth_root<" << opt.root << ">" << (opt.root <= 5 ? "" : " with runtime powers") << ")\n";
     }
+    if (opt.inverse) std::cout << "Output: a^(-1/" << opt.root << ") (--inverse, the inverse-root iterate)\n";
+    if (plan.builtin) std::cout << "Tier: mpfr_sqrt (--tier " << opt.tier << ", <= " << BUILTIN_TIER_MAX_BITS << " bits; --tier mpfr runs " << opt.method << ")\n";
+    else if (plan.fixed) std::cout << "Tier: fixed-limb " << fixed_size_bits(bits) << "-bit kernel (--tier " << opt.tier << ", <= " << FIXED_MAX_BITS << " bits; --tier mpfr runs the general one)\n";
+    else if (opt.tier != "mpfr") std::cout << "Tier: general " << opt.method << " kernel (--tier " << opt.tier << " does not apply to this run)\n";
+    std::cout << "Precision schedule: " << (resumed_bits ? "doubling, until converged (implied by --resume-from)" : opt.precision_schedule) << "\n";
+    if (resumed_bits) std::cout << "Resumed from: " << opt.resume_from << " (" << resumed_bits << " correct bits)\n";
+    std::cout << "Initial guess (used): " << dec(opt.method == "recip" || opt.method == "karp" ? y0 : x0) << "\n\n";
 
-    // if user chooses reciprocal method but provided init_mode manual as sqrt guess, convert to y0
-    mpreal y0;
-    if (opt.method == "recip") {
-        if (opt.init_mode == "manual" && !opt.init_value.empty()) {
-            // interpret init_value as sqrt guess -> convert to reciprocal
-            mpreal sqrt_guess = mpreal(opt.init_value);
-            if (sqrt_guess == 0) {
-                std::cerr << "Zero initial guess for reciprocal method invalid\n";
-                return 1;
-            }
-            y0 = 1 / sqrt_guess;
-        }
-        else {
-            // use reciprocal of the auto initial guess
-            if (x0 == 0) {
-                y0 = mpreal(1); // fallback
-            }
-            else {
-                y0 = 1 / x0;
+    // The per-iteration table and the CSV are written as iterates are produced (including the
+    // initial value as iteration 0); nothing is kept once a row is out. Each row's error is
+    // computed once and shared by the table and the writers.
+    std::unique_ptr<ErrorMeter> errors;
+    if (ref && !ref_alongside) errors.reset(new ErrorMeter(reference));
+    DecimalFormatter err_dec(ERROR_PRINT_DIGITS);
+    std::unique_ptr<IterationCsvWriter> csv;
+    if (!opt.save_csv.empty()) {
+        csv.reset(new IterationCsvWriter(opt.save_csv, output_digits(opt)));
+    }
+    std::unique_ptr<IterationBinWriter> bin;
+    if (!opt.save_bin.empty()) bin.reset(new IterationBinWriter(opt.save_bin, bits));
+    if (!opt.quiet) {
+        std::cout << (ref ? "Per-iteration table (i, value, abs_error_vs_ref, rel_error_vs_ref, prec_bits)"
+                          : "Per-iteration table (i, value, prec_bits)") << "\n";
+    }
+    IterationSink sink;
+    if (!opt.quiet || csv || bin) {
+        sink = [&](int i, const mpreal& val) {
+            const IterateError* e = errors ? &(*errors)(val) : nullptr;
+            if (!opt.quiet) {
+                std::cout << std::setw(4) << i << ": " << dec(val);
+                if (e) std::cout << "  | abs_err=" << err_dec(e->abs_err) << "  | rel_err=" << err_dec(e->rel_err);
+                std::cout << "  | prec=" << val.getPrecision() << "\n";
             }
-        }
+            if (csv) csv->write(i, val, e);
+            if (bin) bin->write(i, val, e);
+            };
     }
 
+    // Compare to builtin sqrt (mpreal) at current precision
+    mpreal builtin(0, mem.builtin ? a.getPrecision() : MPFR_PREC_MIN);
+    std::thread builtin_thread, ref_thread;
+    auto timed = [&](const char* name, const std::function<void()>& f) { // helper-thread phase for --stats
+        auto t0 = std::chrono::steady_clock::now();
+        f();
+        stats.add(name, t0, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count());
+    };
+    if (helpers && mem.builtin) builtin_thread = std::thread([&]() { timed("builtin", [&]() { builtin_root(builtin.mpfr_ptr(), a.mpfr_srcptr(), opt.root, opt.inverse); }); });
+    if (ref_alongside) ref_thread = std::thread([&]() { timed("reference", [&]() { build_reference(a_in.mpfr_srcptr(), bits, reference, opt.root, opt.inverse); }); });
+
     // Run chosen method and time it
-    std::pair<mpreal, std::vector<mpreal>> raw_result;
-    long long elapsed_ns = 0;
+    std::unique_ptr<ParallelMul> par_mul;
+    if (helpers && bits >= static_cast<unsigned long>(PAR_MUL_MIN_LIMBS * GMP_NUMB_BITS)) par_mul.reset(new ParallelMul(threads));
+    stats.begin("kernel");
+    SqrtRun run = run_method(opt, plan, a, x0, y0, sink);
+    par_mul.reset();
+    long long elapsed_ns = run.elapsed_ns;
+    mpreal approx = std::move(run.approx);
+    if (!opt.quiet) std::cout << "\n";
+    VerifyResult verified;
+    long long verify_ns = 0;
+    if (!opt.verify.empty()) {
+        stats.begin("verify");
+        auto t = time_in_ns([&]() { return verify_rounding(a.mpfr_srcptr(), approx); });
+        verified = t.first;
+        verify_ns = t.second;
+    }
 
-    if (opt.method == "heron") {
-        auto lambda = [&]() {
-            return newton_heron(a, x0, opt.iterations);
-            };
-        auto timed = time_in_ns(lambda);
-        raw_result = timed.first;
-        elapsed_ns = timed.second;
+    if (builtin_thread.joinable()) builtin_thread.join();
+    else if (mem.builtin) {
+        stats.begin("builtin");
+        builtin_root(builtin.mpfr_ptr(), a.mpfr_srcptr(), opt.root, opt.inverse);
     }
-    else if (opt.method == "recip") {
-        auto lambda = [&]() {
-            return reciprocal_sqrt(a, y0, opt.iterations);
-            };
-        auto timed = time_in_ns(lambda);
-        raw_result = timed.first;
-        elapsed_ns = timed.second;
+    if (mem.chunked_output) { // only the result and the reference are printed from here on
+        shrink_value(a, MPFR_PREC_MIN);
+        shrink_value(x0, MPFR_PREC_MIN);
+        shrink_value(y0, MPFR_PREC_MIN);
     }
-    else {
-        std::cerr << "Unknown method: " << opt.method << "\n";
-        return 1;
+    if (ref_thread.joinable()) {
+        ref_thread.join();
+        shrink_value(a_in, MPFR_PREC_MIN);
+        errors.reset(new ErrorMeter(reference));
     }
-
-    mpreal approx = raw_result.first;
-    std::vector<mpreal> iterations = raw_result.second;
-
-    // Compare to builtin sqrt (mpreal) at current precision
-    mpreal builtin = mpfr::sqrt(a);
+    if (errors) stats.begin("compare");
+    const IterateError* final_err = errors ? &(*errors)(approx) : nullptr;
+    stats.begin("output");
 
 #ifdef USE_BOOST
     // optional Boost comparison (if compiled with USE_BOOST)
@@ -288,50 +3809,61 @@ int main(int argc, char** argv) {
     cpp_dec_float_50 boost_sqrt = sqrt(boost_a);
 #endif
 
-    // Print summary
-    std::cout << std::setprecision(static_cast<int>(opt.prec_digits)) << std::scientific;
-    std::cout << "Input: " << opt.number << "\n";
-    std::cout << "Precision: " << opt.prec_digits << " decimal digits (" << bits << " bits)\n";
-    std::cout << "Method: " << opt.method << ", iterations requested: " << opt.iterations << "\n";
-    std::cout << "Initial guess (used): " << (opt.method == "heron" ? x0 : y0) << "\n";
-    std::cout << "Time elapsed: " << elapsed_ns << " ns\n\n";
-
-    std::cout << "Reference (high-precision) sqrt: " << reference << "\n";
-    std::cout << "Builtin mpfr sqrt (current precision): " << builtin << "\n";
-    std::cout << "Final approx after iterations: " << approx << "\n";
+    if (plan.stop.enabled) {
+        std::cout << "Iterations used: " << run.iterations_used << " of " << opt.iterations
+            << (run.iterations_used < opt.iterations ? " (converged)" : " (cap reached)") << "\n";
+    }
+    std::cout << "Time elapsed: " << elapsed_ns << " ns\n";
+    if (!opt.verify.empty()) std::cout << "Verify (cheap): " << format_verify(verified) << " (" << verify_ns << " ns)\n";
+    if (opt.arena) std::cout << format_arena_stats(GmpArena::total(thread_arena())) << "\n";
+    if (!opt.spill_dir.empty()) std::cout << SpillStore::instance().summary() << "\n";
+    std::cout << "\n";
 
-    mpreal abs_err_final = abs(approx - reference);
-    mpreal rel_err_final = (reference == 0) ? mpreal(0) : abs_err_final / abs(reference);
-    std::cout << "Absolute error vs reference: " << abs_err_final << "\n";
-    std::cout << "Relative error vs reference: " << rel_err_final << "\n\n";
+    auto print_value = [&](const mpreal& v) {
+        if (mem.chunked_output) write_decimal_chunked(std::cout, v.mpfr_srcptr(), output_digits(opt));
+        else std::cout << dec(v);
+    };
+    if (ref) {
+        std::cout << "Reference (high-precision) " << root_name << ": ";
+        print_value(reference);
+        std::cout << "\n";
+    }
+    std::cout << "Builtin mpfr " << root_name << " (current precision): ";
+    if (mem.builtin) print_value(builtin);
+    else std::cout << builtin_skipped;
+    std::cout << "\n";
+    std::cout << "Final approx after iterations: ";
+    print_value(approx);
+    std::cout << "\n";
 
-    // Show per-iteration values (including initial value stored as iteration 0)
-    std::cout << "Per-iteration table (i, value, abs_error_vs_ref, rel_error_vs_ref)" << "\n";
-    for (size_t i = 0; i < iterations.size(); ++i) {
-        mpreal val = iterations[i];
-        mpreal aerr = abs(val - reference);
-        mpreal rerr = (reference == 0) ? mpreal(0) : aerr / abs(reference);
-        std::cout << std::setw(4) << i << ": " << val << "  | abs_err=" << aerr << "  | rel_err=" << rerr << "\n";
+    if (final_err) {
+        std::cout << "Absolute error vs reference: " << err_dec(final_err->abs_err) << "\n";
+        std::cout << "Relative error vs reference: " << err_dec(final_err->rel_err) << "\n";
     }
 
-    if (!opt.save_csv.empty()) {
-        save_iterations_csv(opt.save_csv, iterations, reference, static_cast<unsigned int>(opt.prec_digits));
+    if (csv && csv->ok()) {
         std::cout << "Saved iterations to: " << opt.save_csv << "\n";
     }
+    if (bin && bin->ok()) {
+        std::cout << "Saved binary iterations to: " << opt.save_bin << "\n";
+    }
 
 #ifdef USE_BOOST
-    std::cout << "\nBoost (cpp_dec_float_50) sqrt: " << boost_sqrt << "\n";
+    if (opt.root == 2 && !opt.inverse) std::cout << "\nBoost (cpp_dec_float_50) sqrt: " << boost_sqrt << "\n";
 #endif
 
-    // Compare to std::sqrt (double)
-    try {
-        double d = std::stod(opt.number);
-        double ds = std::sqrt(d);
-        std::cout << "\nstd::sqrt (double): " << std::setprecision(17) << ds << "\n";
-    }
-    catch (...) {
-        // ignore
+    // Compare to the same root in double: std::sqrt, std::cbrt or std::pow(a, 1/N), inverted for --inverse
+    if (double_ok) {
+        double n = static_cast<double>(opt.root);
+        double ds = opt.root == 2 ? std::sqrt(a_double) : opt.root == 3 ? std::cbrt(a_double) : std::pow(a_double, 1.0 / n);
+        std::string label = opt.root == 2 ? "std::sqrt" : opt.root == 3 ? "std::cbrt" : "std::pow(a, 1/" + std::to_string(opt.root) + ")";
+        if (opt.inverse) {
+            ds = 1.0 / ds;
+            label = "1/" + label;
+        }
+        std::cout << "\n" << label << " (double): " << std::setprecision(17) << ds << "\n";
     }
 
-    return 0;
+    return write_stats(opt, stats) ? 0 : 1;
 }
+#endif // MPREAL_SQRT_NO_MAIN
@@ -9,7 +9,7 @@ Example API JSON body:
   "number": "2",
   "prec_digits": 200,
   "iterations": 20,
-  "method": "heron",        # "heron" or "recip"
+  "method": "heron",        # "heron" or "recip" ("karp" too when the C++ engine is used)
   "init_mode": "auto",      # "auto" or "manual"
   "init_value": "",         # string, used when init_mode=="manual"
   "include_iterations": true,
@@ -23,6 +23,10 @@ import time
 import io
 import csv
 import math
+import json
+import os
+import queue
+import subprocess
 
 app = Flask(__name__)
 
@@ -59,6 +63,7 @@ INDEX_HTML = """
   <select id="method">
     <option value="heron">heron (Newton)</option>
     <option value="recip">reciprocal-sqrt</option>
+    <option value="karp">karp-markstein (C++ engine only)</option>
   </select>
 
   <label>Initial guess mode</label>
@@ -123,6 +128,62 @@ async function submitForm(){
 </script>
 """
 
+# C++ engine: Perhitungan.cpp built as mpreal_sqrt and run with --serve (one JSON request per line
+# on stdin, one JSON response per line on stdout). When the binary exists, /api/sqrt is answered by
+# a pool of warm engine processes; otherwise the mpmath implementation below is used.
+ENGINE_PATH = os.environ.get("SQRT_ENGINE", "./mpreal_sqrt")
+ENGINE_WORKERS = int(os.environ.get("SQRT_ENGINE_WORKERS", "4"))
+
+class EngineWorker:
+    def __init__(self, path):
+        self.proc = subprocess.Popen([path, "--serve"], stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                                     text=True, bufsize=1)
+
+    def alive(self):
+        return self.proc.poll() is None
+
+    def call(self, req):
+        self.proc.stdin.write(json.dumps(req) + "\n")
+        self.proc.stdin.flush()
+        line = self.proc.stdout.readline()
+        if not line:
+            raise RuntimeError("engine worker exited")
+        return json.loads(line)
+
+    def close(self):
+        try:
+            self.proc.kill()
+        except Exception:
+            pass
+
+class EnginePool:
+    # Each worker serves one request at a time; a request borrows an idle worker and returns it.
+    # Workers start on first use and are restarted if one dies.
+    def __init__(self, path, size):
+        self.path = path
+        self.idle = queue.Queue()
+        for _ in range(max(1, size)):
+            self.idle.put(None)
+
+    def call(self, req):
+        w = self.idle.get()
+        try:
+            if w is None or not w.alive():
+                w = EngineWorker(self.path)
+            return w.call(req)
+        except Exception:
+            if w is not None:
+                w.close()
+            w = None
+            raise
+        finally:
+            self.idle.put(w)
+
+ENGINE = EnginePool(ENGINE_PATH, ENGINE_WORKERS) if os.access(ENGINE_PATH, os.X_OK) else None
+
+# --serve response members the mpmath path does not have; dropped so both paths answer alike
+ENGINE_ONLY_KEYS = ("iterations_used", "cached", "exact", "resumed_bits", "root", "inverse")
+
 def clamp_int(v, mn, mx):
     try:
         i = int(v)
@@ -207,7 +268,10 @@ def api_sqrt():
 
     iterations = clamp_int(payload.get("iterations", DEFAULT_ITERATIONS), 0, MAX_ITERATIONS)
     method = payload.get("method", "heron")
-    if method not in ("heron", "recip"):
+    if ENGINE is not None:
+        if method not in ("heron", "recip", "karp"):
+            return "method must be 'heron', 'recip' or 'karp'", 400
+    elif method not in ("heron", "recip"):
         return "method must be 'heron' or 'recip'", 400
 
     init_mode = payload.get("init_mode", "auto")
@@ -217,6 +281,10 @@ def api_sqrt():
     include_iterations = bool(payload.get("include_iterations", True))
     save_csv = bool(payload.get("save_csv", False))
 
+    if ENGINE is not None:
+        return api_sqrt_engine(num_str, prec_digits, iterations, method, init_mode, init_value,
+                               include_iterations, save_csv)
+
     extra_ref = 20
     try:
         with mp.workdps(prec_digits + extra_ref):
@@ -328,6 +396,43 @@ def api_sqrt():
     except Exception as e:        
         return f"Internal error during computation: {e}", 500
 
+def api_sqrt_engine(num_str, prec_digits, iterations, method, init_mode, init_value, include_iterations, save_csv):
+    req = {
+        "number": num_str,
+        "prec_digits": prec_digits,
+        "iterations": iterations,
+        "method": method,
+        "init_mode": init_mode,
+        "init_value": init_value or "",
+        "include_iterations": include_iterations or save_csv,
+    }
+    try:
+        result = ENGINE.call(req)
+    except Exception as e:
+        return f"Internal error during computation: {e}", 500
+    if "error" in result:
+        return result["error"], result.get("status", 400)
+
+    if save_csv:
+        csv_buf = io.StringIO()
+        writer = csv.writer(csv_buf)
+        writer.writerow(["iteration", "value", "abs_error", "rel_error"])
+        for row in result.get("iterations", []):
+            writer.writerow([row["i"], row["value"], row["abs_err"], row["rel_err"]])
+        csv_bytes = csv_buf.getvalue().encode("utf-8")
+        return send_file(
+            io.BytesIO(csv_bytes),
+            mimetype="text/csv",
+            as_attachment=True,
+            download_name="iterations.csv"
+        )
+
+    for key in ENGINE_ONLY_KEYS:
+        result.pop(key, None)
+    if not include_iterations:
+        result.pop("iterations", None)
+    return jsonify(result), 200
+
 if __name__ == "__main__":
     # For local testing only. Use gunicorn in production.
     app.run(host="127.0.0.1", port=8080, debug=False)
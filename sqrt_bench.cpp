@@ -0,0 +1,210 @@
+// sqrt_bench.cpp
+// Regression benchmark for the Perhitungan.cpp kernels, built as its own binary next to it:
+//   g++ -O2 -std=c++17 -I./include sqrt_bench.cpp -lmpfr -lgmp -o sqrt_bench
+// - Runs a fixed matrix: methods heron/recip/karp x digits 10 .. 10^7 x seed modes auto/manual x
+//   inputs (perfect square, near zero, huge exponents, the README examples)
+// - Every cell is timed over repeated runs (kernel time only, as --bench) and checked against
+//   mpfr_sqrt; results go out as CSV
+// - With --baseline <csv> (an earlier run), exits 2 when a cell's median is slower than the baseline
+//   median by more than --threshold, or when a result is off by more than MAX_ULP_ERROR ulps
+
+#define MPREAL_SQRT_NO_MAIN
+#include "Perhitungan.cpp"
+
+namespace {
+
+const char* const SUITE_METHODS[] = { "heron", "recip", "karp" };
+const unsigned long SUITE_DIGITS[] = { 10, 100, 1000, 10000, 100000, 1000000, 10000000 };
+const char* const SUITE_SEEDS[] = { "auto", "manual" };
+const char* const SUITE_INPUTS[] = {
+    "2", "10", "123456789", "99999999999999999999", // README examples
+    "152415787532388367501905199875019052100",     // perfect square, 12345678901234567890^2
+    "1e-300", "3.7e-123456",                       // near zero
+    "6.02214076e23", "1.5e987654",                 // huge exponents
+};
+
+// Manual seeds carry this many bits, fewer than the automatic guess, so the kernels do real work
+const mpfr_prec_t MANUAL_SEED_BITS = 24;
+const double MAX_ULP_ERROR = 2; // kernel result vs mpfr_sqrt
+
+struct SuiteOptions {
+    unsigned long max_digits = 10000000;
+    int reps = 5;
+    int warmup = 1;
+    long long cell_budget_ms = 2000; // fewer reps once a cell has run this long (at least one timed run)
+    std::string schedule = "doubling";
+    int iterations = 40;
+    std::string out = ""; // empty -> stdout
+    std::string baseline = "";
+    double threshold = 0.10; // allowed median slowdown vs baseline (0.10 = 10%)
+    long long noise_ns = 2000; // absolute slack on top of threshold for tiny cells
+    bool show_help = false;
+};
+
+SuiteOptions parse_suite_args(int argc, char** argv) {
+    SuiteOptions opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--help" || a == "-h") { opt.show_help = true; break; }
+        if (a == "--max-digits" && i + 1 < argc) opt.max_digits = std::stoul(argv[++i]);
+        else if (a == "--reps" && i + 1 < argc) opt.reps = std::stoi(argv[++i]);
+        else if (a == "--warmup" && i + 1 < argc) opt.warmup = std::stoi(argv[++i]);
+        else if (a == "--cell-budget-ms" && i + 1 < argc) opt.cell_budget_ms = std::stoll(argv[++i]);
+        else if (a == "--precision-schedule" && i + 1 < argc) opt.schedule = argv[++i];
+        else if (a == "--iterations" && i + 1 < argc) opt.iterations = std::stoi(argv[++i]);
+        else if (a == "--out" && i + 1 < argc) opt.out = argv[++i];
+        else if (a == "--baseline" && i + 1 < argc) opt.baseline = argv[++i];
+        else if (a == "--threshold" && i + 1 < argc) opt.threshold = std::stod(argv[++i]);
+        else if (a == "--noise-ns" && i + 1 < argc) opt.noise_ns = std::stoll(argv[++i]);
+        else {
+            std::cerr << "Unknown or incomplete option: " << a << "\n";
+            opt.show_help = true;
+            break;
+        }
+    }
+    return opt;
+}
+
+void print_suite_help() {
+    std::cout << "sqrt_bench - regression benchmark matrix for the sqrt kernels\n\n";
+    std::cout << "Usage:\n  ./sqrt_bench [options]\n\n";
+    std::cout << "Options:\n";
+    std::cout << "  --max-digits <n>        largest precision of the matrix (default 10000000)\n";
+    std::cout << "  --reps <n>              timed runs per cell (default 5)\n";
+    std::cout << "  --warmup <n>            untimed runs per cell (default 1)\n";
+    std::cout << "  --cell-budget-ms <ms>   stop repeating a cell after this long (default 2000)\n";
+    std::cout << "  --precision-schedule <fixed|doubling>  kernel schedule (default doubling)\n";
+    std::cout << "  --iterations <n>        iteration cap, with --until-converged (default 40)\n";
+    std::cout << "  --out <file>            CSV results (default stdout)\n";
+    std::cout << "  --baseline <file>       CSV of an earlier run; exit 2 on a slowdown past --threshold\n";
+    std::cout << "  --threshold <x>         allowed median slowdown, 0.10 = 10% (default 0.10)\n";
+    std::cout << "  --noise-ns <ns>         absolute slack added to the allowed median (default 2000)\n";
+}
+
+std::string cell_key(const std::string& input, unsigned long digits, const std::string& method, const std::string& seed) {
+    return input + ',' + std::to_string(digits) + ',' + method + ',' + seed;
+}
+
+// Baseline medians by cell_key, read from a CSV written by this program
+bool read_baseline(const std::string& file, std::map<std::string, long long>& medians) {
+    std::ifstream f(file);
+    if (!f) {
+        std::cerr << "Cannot open baseline: " << file << "\n";
+        return false;
+    }
+    std::string line;
+    std::getline(f, line); // header
+    while (std::getline(f, line)) {
+        std::vector<std::string> col = split_list(line);
+        if (col.size() < 8) continue;
+        try {
+            medians[cell_key(col[0], std::stoul(col[1]), col[2], col[3])] = std::stoll(col[7]);
+        }
+        catch (...) {
+            std::cerr << "Skipping malformed baseline line: " << line << "\n";
+        }
+    }
+    return true;
+}
+
+// |x - s| in ulps of s
+double ulp_error(const mpreal& x, const mpreal& s) {
+    if (mpfr_equal_p(x.mpfr_srcptr(), s.mpfr_srcptr())) return 0;
+    if (!mpfr_regular_p(s.mpfr_srcptr())) return mpfr_zero_p(s.mpfr_srcptr()) && mpfr_zero_p(x.mpfr_srcptr()) ? 0 : INFINITY;
+    mpreal d(0, 64);
+    mpfr_sub(d.mpfr_ptr(), x.mpfr_srcptr(), s.mpfr_srcptr(), MPFR_RNDN);
+    mpfr_abs(d.mpfr_ptr(), d.mpfr_srcptr(), MPFR_RNDN);
+    mpfr_mul_2si(d.mpfr_ptr(), d.mpfr_srcptr(), s.getPrecision() - mpfr_get_exp(s.mpfr_srcptr()), MPFR_RNDN);
+    return mpfr_get_d(d.mpfr_srcptr(), MPFR_RNDN);
+}
+
+// The --init-value the manual cells use: the automatic guess cut to MANUAL_SEED_BITS, in decimal
+std::string manual_seed(const mpreal& a) {
+    mpreal x0 = round_to_prec(auto_initial_guess(a), MANUAL_SEED_BITS);
+    std::ostringstream os;
+    DecimalFormatter(9).write(os, x0);
+    return os.str();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    SuiteOptions so = parse_suite_args(argc, argv);
+    if (so.show_help) { print_suite_help(); return 0; }
+    std::map<std::string, long long> baseline;
+    if (!so.baseline.empty() && !read_baseline(so.baseline, baseline)) return 1;
+    std::ofstream file;
+    if (!so.out.empty()) {
+        file.open(so.out);
+        if (!file) {
+            std::cerr << "Could not open file for writing: " << so.out << "\n";
+            return 1;
+        }
+    }
+    std::ostream& out = so.out.empty() ? std::cout : file;
+    out << "input,digits,method,seed,iterations_used,reps,min_ns,median_ns,p95_ns,mad_ns,ulp_error,baseline_median_ns,status\n";
+
+    int slow = 0, wrong = 0, cells = 0;
+    for (unsigned long digits : SUITE_DIGITS) {
+        if (digits > so.max_digits) continue;
+        mpfr_prec_t bits = digits_to_bits(digits);
+        mpfr::mpreal::set_default_prec(bits);
+        KernelScratch scratch;
+        scratch.reserve(bits);
+        for (const char* input : SUITE_INPUTS) {
+            mpreal a(0, bits);
+            mpfr_set_str(a.mpfr_ptr(), input, 10, MPFR_RNDN);
+            mpreal want(0, bits);
+            mpfr_sqrt(want.mpfr_ptr(), a.mpfr_srcptr(), MPFR_RNDN);
+            for (const char* method : SUITE_METHODS) {
+                for (const char* seed : SUITE_SEEDS) {
+                    Options opt;
+                    opt.number = input;
+                    opt.prec_digits = digits;
+                    opt.method = method;
+                    opt.precision_schedule = so.schedule;
+                    opt.iterations = so.iterations;
+                    opt.until_converged = true;
+                    opt.init_mode = seed;
+                    if (opt.init_mode == "manual") opt.init_value = manual_seed(a);
+                    KernelPlan plan;
+                    mpreal x0, y0;
+                    if (!make_plan(opt, bits, plan) || !prepare_seeds(opt, a, x0, y0)) return 1;
+
+                    SqrtRun run;
+                    std::vector<long long> samples;
+                    long long spent_ns = 0;
+                    for (int r = 0; r < so.warmup + so.reps; ++r) {
+                        run = run_method(opt, plan, a, x0, y0, nullptr, &scratch);
+                        spent_ns += run.elapsed_ns;
+                        if (r >= so.warmup || spent_ns > so.cell_budget_ms * 1000000) samples.push_back(run.elapsed_ns);
+                        if (!samples.empty() && spent_ns > so.cell_budget_ms * 1000000) break;
+                    }
+                    BenchStats st = summarize_ns(samples);
+                    double ulps = ulp_error(run.approx, want);
+
+                    std::string status = "ok";
+                    if (!(ulps <= MAX_ULP_ERROR)) {
+                        status = "wrong";
+                        ++wrong;
+                    }
+                    std::string key = cell_key(input, digits, method, seed);
+                    auto base = baseline.find(key);
+                    long long base_ns = base == baseline.end() ? -1 : base->second;
+                    if (base_ns >= 0 && st.median_ns > static_cast<long long>(base_ns * (1 + so.threshold)) + so.noise_ns && status == "ok") {
+                        status = "slow";
+                        ++slow;
+                    }
+                    out << key << ',' << run.iterations_used << ',' << samples.size() << ',' << st.min_ns << ',' << st.median_ns
+                        << ',' << st.p95_ns << ',' << st.mad_ns << ',' << ulps << ',' << base_ns << ',' << status << "\n";
+                    out.flush();
+                    ++cells;
+                    if (status != "ok") std::cerr << key << ": " << status << " (median " << st.median_ns << " ns, baseline " << base_ns << " ns, " << ulps << " ulps)\n";
+                }
+            }
+        }
+        std::cerr << "sqrt_bench: " << digits << " digits done\n";
+    }
+    std::cerr << "sqrt_bench: " << cells << " cells, " << slow << " slower than baseline, " << wrong << " wrong\n";
+    return slow || wrong ? 2 : 0;
+}